@@ -0,0 +1,94 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "bench.hpp"
+#include "game.hpp"
+#include <sstream>
+#include <nlohmann/json.hpp>
+
+static constexpr int64_t REGIONS_PER_RESOLUTION = 24;
+
+// regions.json shaped like the deployed one: a game list plus one object per game with
+// regions for a couple of resolutions
+static std::string make_catalog(std::mt19937 &rng, size_t game_count)
+{
+	static const char *anchors[] = {"top_left", "top_middle", "top_right", "middle_left", "center", "middle_right", "bottom_left",
+					"bottom_middle", "bottom_right"};
+	static const char *resolutions[] = {"1920x1080", "2560x1440"};
+	std::uniform_real_distribution<float> pos(0.0f, 900.0f), size(16.0f, 400.0f);
+	std::uniform_int_distribution<size_t> anchor(0, sizeof(anchors) / sizeof(anchors[0]) - 1);
+
+	nlohmann::json catalog = nlohmann::json::object();
+	nlohmann::json games = nlohmann::json::array();
+	for (size_t g = 0; g < game_count; g++) {
+		std::string name = "game" + std::to_string(g);
+		games.push_back(name);
+
+		nlohmann::json game = {
+			{"name_verbose", "Game " + std::to_string(g)},
+			{"hud_scale", {0.5, 1.5, 0.05}},
+			{"resolutions", resolutions},
+		};
+		for (const char *resolution : resolutions) {
+			nlohmann::json regions = nlohmann::json::array();
+			for (int64_t i = 0; i < REGIONS_PER_RESOLUTION; i++) {
+				regions.push_back({{"game_state", "match"},
+						   {"region", "region" + std::to_string(i)},
+						   {"alignment", anchors[anchor(rng)]},
+						   {"x", pos(rng)},
+						   {"y", pos(rng)},
+						   {"w", size(rng)},
+						   {"h", size(rng)}});
+			}
+			game[resolution] = regions;
+		}
+		catalog[name] = game;
+	}
+	catalog["games"] = games;
+	return catalog.dump();
+}
+
+void noice::bench::run_catalog(runner &r)
+{
+	const options &opts = r.opts();
+
+	for (int64_t game_count : opts.games) {
+		std::mt19937 rng = noice::bench::rng(opts, (uint32_t)game_count);
+		std::string catalog = make_catalog(rng, (size_t)game_count);
+		params_t params = {{"games", game_count}, {"bytes", (int64_t)catalog.size()}};
+
+		noice::game_manager lazy;
+		r.run("catalog.refresh_main", params, (uint64_t)game_count, [&]() {
+			std::istringstream input(catalog);
+			return (uint64_t)lazy.refresh_main(input);
+		});
+
+		// Every game parsed up front, what refresh_main did before the lazy catalog
+		noice::game_manager eager;
+		eager.configure(false, SIZE_MAX, "");
+		r.run("catalog.refresh_main_eager", params, (uint64_t)game_count, [&]() {
+			std::istringstream input(catalog);
+			return (uint64_t)eager.refresh_main(input);
+		});
+
+		// First lookup of a game, materializing it from the catalog text
+		std::string last = "game" + std::to_string(game_count - 1);
+		r.run("catalog.materialize", params, 1, [&]() {
+			std::istringstream input(catalog);
+			lazy.refresh_main(input);
+			return (uint64_t)(lazy.get_game(last) != nullptr);
+		});
+	}
+}
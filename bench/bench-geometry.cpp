@@ -0,0 +1,226 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "bench.hpp"
+#include "game.hpp"
+#include "validation.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace validation = noice::validation;
+
+static constexpr float CANVAS_WIDTH = 1920.0f;
+static constexpr float CANVAS_HEIGHT = 1080.0f;
+
+// Mostly upright items of assorted sizes, a few rotated or flipped like in real scenes
+static std::vector<validation::item> make_items(std::mt19937 &rng, size_t count)
+{
+	std::uniform_real_distribution<float> pos_x(-200.0f, CANVAS_WIDTH), pos_y(-200.0f, CANVAS_HEIGHT);
+	std::uniform_real_distribution<float> size(32.0f, 900.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+	std::uniform_int_distribution<int> kind(0, 9);
+
+	std::vector<validation::item> items(count);
+	for (size_t i = 0; i < count; i++) {
+		validation::item &it = items[i];
+		float w = size(rng), h = size(rng);
+		float rot = kind(rng) == 0 ? angle(rng) : 0.0f;
+		if (kind(rng) == 0)
+			w = -w;
+
+		float c = cosf(rot), s = sinf(rot);
+		it.source_id = (uint32_t)(i / 2 + 1);
+		it.box_transform = {{w * c, w * s}, {-h * s, h * c}, {pos_x(rng), pos_y(rng)}};
+		it.parent_transform = validation::transform::identity();
+		it.local_box_transform = it.box_transform;
+		it.box_scale = {1.0f, 1.0f};
+		it.coverage = validation::canvas_coverage(it.box_transform.t, {w, h}, rot * 57.29578f, CANVAS_WIDTH, CANVAS_HEIGHT);
+		it.main_video = false;
+	}
+	return items;
+}
+
+static std::vector<validation::region> make_regions(std::mt19937 &rng, size_t count)
+{
+	std::uniform_real_distribution<float> pos_x(0.0f, CANVAS_WIDTH - 64.0f), pos_y(0.0f, CANVAS_HEIGHT - 64.0f);
+	std::uniform_real_distribution<float> size(16.0f, 400.0f);
+	std::uniform_int_distribution<int> kind(0, 3);
+
+	std::vector<validation::region> regions(count);
+	for (size_t i = 0; i < count; i++) {
+		regions[i].box = {pos_x(rng), pos_y(rng), size(rng), size(rng)};
+		regions[i].min_area = kind(rng) == 0 ? regions[i].box.w * regions[i].box.h * 0.25f : 0.0f;
+		regions[i].id = (uint32_t)i;
+	}
+	return regions;
+}
+
+static std::vector<noice::region> make_game_regions(std::mt19937 &rng, size_t count)
+{
+	static const noice::anchor anchors[] = {noice::TOP_LEFT,      noice::TOP_MIDDLE,   noice::TOP_RIGHT,   noice::MIDDLE_LEFT,
+						noice::CENTER,        noice::MIDDLE_RIGHT, noice::BOTTOM_LEFT, noice::BOTTOM_MIDDLE,
+						noice::BOTTOM_RIGHT,  noice::LEFT,         noice::MIDDLE_X,    noice::RIGHT,
+						noice::TOP,           noice::MIDDLE_Y,     noice::BOTTOM};
+	std::uniform_real_distribution<float> pos_x(0.0f, 1800.0f), pos_y(0.0f, 960.0f);
+	std::uniform_real_distribution<float> size(16.0f, 400.0f);
+	std::uniform_int_distribution<size_t> anchor(0, sizeof(anchors) / sizeof(anchors[0]) - 1);
+	std::uniform_int_distribution<int> locked(0, 3);
+
+	auto base = std::make_shared<noice::video_resolution>();
+	base->width = 1920;
+	base->height = 1080;
+
+	std::vector<noice::region> regions;
+	for (size_t i = 0; i < count; i++) {
+		noice::region_rect rect;
+		rect.x = pos_x(rng);
+		rect.y = pos_y(rng);
+		rect.w = size(rng);
+		rect.h = size(rng);
+		regions.emplace_back(base, "state", "region" + std::to_string(i), anchors[anchor(rng)], locked(rng) == 0, rect);
+	}
+	return regions;
+}
+
+// Validators submit without regions once the game is turned off, and without a scene once
+// they stop being drawn. Both have to end every occlusion the stats show as active.
+static void check_occlusions_end(noice::bench::runner &r, std::shared_ptr<const validation::scene_snapshot> snapshot,
+				 std::shared_ptr<const std::vector<validation::region>> regions, int64_t item_count, int64_t region_count)
+{
+	validation::occlusion_stats stats;
+	validation::engine engine(nullptr, [&stats](const validation::occlusion_event &event) {
+		stats.apply(event);
+		return true;
+	});
+
+	auto active = [&stats](uint64_t now) {
+		std::vector<validation::occlusion_summary> summary;
+		stats.summarize(now, summary);
+		return std::count_if(summary.begin(), summary.end(), [](const validation::occlusion_summary &s) { return s.active; });
+	};
+
+	uint64_t time = 1000000000;
+	engine.submit(snapshot, regions, validation::options(), time);
+	if (active(time) == 0)
+		return;
+	engine.submit(nullptr, nullptr, validation::options(), time += 1000000000);
+	if (size_t left = active(time += 1000000000))
+		r.fail("%zu occlusions still active after turning off the game for %" PRId64 " items, %" PRId64 " regions", left,
+		       item_count, region_count);
+
+	engine.submit(snapshot, regions, validation::options(), time += 1000000000);
+	engine.submit(nullptr, regions, validation::options(), time += 1000000000);
+	if (size_t left = active(time += 1000000000))
+		r.fail("%zu occlusions still active after the scene stopped rendering for %" PRId64 " items, %" PRId64 " regions", left,
+		       item_count, region_count);
+}
+
+static std::vector<validation::kernel> supported_kernels()
+{
+	validation::kernel best = validation::detect_kernel();
+	std::vector<validation::kernel> kernels = {validation::kernel::scalar};
+	if (best != validation::kernel::scalar)
+		kernels.push_back(validation::kernel::sse2);
+	if (best == validation::kernel::avx2)
+		kernels.push_back(validation::kernel::avx2);
+	return kernels;
+}
+
+void noice::bench::run_geometry(runner &r)
+{
+	const options &opts = r.opts();
+
+	for (int64_t item_count : opts.items) {
+		for (int64_t region_count : opts.regions) {
+			std::mt19937 rng = noice::bench::rng(opts, (uint32_t)(item_count * 1000 + region_count));
+			auto items = make_items(rng, (size_t)item_count);
+			auto regions = make_regions(rng, (size_t)region_count);
+			params_t params = {{"items", item_count}, {"regions", region_count}};
+			uint64_t pairs = (uint64_t)(item_count * region_count);
+
+			// One item against one region at a time, what the old per pair path did
+			r.run("geometry.item_in_region", params, pairs, [&]() {
+				uint64_t hits = 0;
+				for (const validation::item &it : items) {
+					for (const validation::region &region : regions)
+						hits += validation::item_in_region(it.box_transform, region.box);
+				}
+				return hits;
+			});
+
+			validation::region_batch batch(regions);
+			for (validation::kernel k : supported_kernels()) {
+				r.run(std::string("geometry.region_block.") + validation::kernel_name(k), params, pairs, [&]() {
+					uint64_t hits = 0;
+					for (const validation::item &it : items) {
+						for (size_t block = 0; block < batch.blocks(); block++)
+							hits += validation::item_in_region_block(it.box_transform, batch, block, k);
+					}
+					return hits;
+				});
+			}
+
+			auto snapshot = std::make_shared<validation::scene_snapshot>();
+			snapshot->canvas_width = (uint32_t)CANVAS_WIDTH;
+			snapshot->canvas_height = (uint32_t)CANVAS_HEIGHT;
+			snapshot->items = items;
+			std::shared_ptr<const validation::scene_snapshot> shared_snapshot = snapshot;
+			auto shared_regions = std::make_shared<const std::vector<validation::region>>(regions);
+			validation::options vopts;
+
+			r.run("geometry.validate", params, pairs, [&]() {
+				auto res = validation::validate(shared_snapshot, shared_regions, vopts);
+				return (uint64_t)res->items.size();
+			});
+
+			check_occlusions_end(r, shared_snapshot, shared_regions, item_count, region_count);
+		}
+	}
+
+	for (int64_t region_count : opts.regions) {
+		std::mt19937 rng = noice::bench::rng(opts, (uint32_t)region_count);
+		auto regions = make_game_regions(rng, (size_t)region_count);
+		params_t params = {{"regions", region_count}};
+
+		struct obs_video_info ovi = {};
+		ovi.base_width = 2560;
+		ovi.base_height = 1440;
+
+		r.run("geometry.align_box", params, (uint64_t)region_count, [&]() {
+			float sum = 0.0f;
+			for (const noice::region &region : regions)
+				sum += region.align_box(ovi, 1.25f).x;
+			return (uint64_t)sum;
+		});
+
+		noice::alignment_layout layout(regions);
+		std::vector<noice::region_rect> boxes(regions.size());
+		r.run("geometry.alignment_layout", params, (uint64_t)region_count, [&]() {
+			layout.align(2560.0f, 1440.0f, 1.25f, boxes.data());
+			return (uint64_t)boxes.back().x;
+		});
+
+		r.run("geometry.convert_box", params, (uint64_t)region_count, [&]() {
+			float sum = 0.0f;
+			for (const noice::region &region : regions) {
+				noice::box_tuple box = std::make_tuple(region.rect.x, region.rect.y, region.rect.w, region.rect.h);
+				box = noice::convert_box(box, noice::XYWH, noice::CXCYWH);
+				box = noice::convert_box(box, noice::CXCYWH, noice::XYXY);
+				sum += std::get<2>(box);
+			}
+			return (uint64_t)sum;
+		});
+	}
+}
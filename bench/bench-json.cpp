@@ -0,0 +1,149 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "bench.hpp"
+#include "util/util-json.hpp"
+#include <nlohmann/json.hpp>
+
+struct fake_occlusion {
+	std::string source_name;
+	std::string region;
+	uint64_t duration_ms;
+	bool active;
+};
+
+// Source names as streamers write them, quotes and non-ASCII included so escaping is measured
+static std::vector<fake_occlusion> make_occlusions(std::mt19937 &rng, size_t count)
+{
+	static const char *names[] = {"Webcam", "Cam \"main\"", "Überlay ✨", "Alerts\\Follow", "Chat box", "BRB screen"};
+	std::uniform_int_distribution<size_t> name(0, sizeof(names) / sizeof(names[0]) - 1);
+	std::uniform_int_distribution<uint64_t> duration(0, 600000);
+
+	std::vector<fake_occlusion> occlusions(count);
+	for (size_t i = 0; i < count; i++) {
+		occlusions[i].source_name = std::string(names[name(rng)]) + " " + std::to_string(i);
+		occlusions[i].region = "fortnite/ingame/minimap" + std::to_string(i % 24);
+		occlusions[i].duration_ms = duration(rng);
+		occlusions[i].active = i % 3 == 0;
+	}
+	return occlusions;
+}
+
+// Same document shape as scene_tracker::send_diagnostics used to build
+static void build_tree(const std::vector<fake_occlusion> &occlusions, std::string &out)
+{
+	nlohmann::json list = nlohmann::json::array();
+	nlohmann::json names = nlohmann::json::array();
+	nlohmann::json entries = nlohmann::json::array();
+	for (const fake_occlusion &o : occlusions) {
+		list.push_back({{"sourceName", o.source_name}, {"region", o.region}, {"durationMs", o.duration_ms}, {"active", o.active}});
+		names.push_back(o.source_name);
+		entries.push_back({{"sourceName", o.source_name},
+				   {"region", o.region},
+				   {"totalMs", o.duration_ms},
+				   {"longestMs", o.duration_ms / 2},
+				   {"fraction", 0.25f},
+				   {"active", o.active}});
+	}
+
+	nlohmann::json payload = {
+		{"event",
+		 {
+			 {"obsPluginInfo", {{"obsVersion", "29.1.3"}, {"pluginVersion", "1.0.0"}}},
+			 {"obsNoiceValidator",
+			  {
+				  {"missingValidator", false},
+				  {"occludingSourceNames", names},
+				  {"occlusions", list},
+				  {"occlusionStats", {{"observedMs", 3600000}, {"entries", entries}}},
+			  }},
+		 }},
+	};
+	out = payload.dump();
+}
+
+static void build_writer(const std::vector<fake_occlusion> &occlusions, std::string &out)
+{
+	noice::util::json_writer json(out);
+	json.begin_object().key("event").begin_object();
+	json.key("obsPluginInfo").begin_object().member("obsVersion", "29.1.3").member("pluginVersion", "1.0.0").end_object();
+
+	json.key("obsNoiceValidator").begin_object();
+	json.member("missingValidator", false);
+	json.key("occlusions").begin_array();
+	for (const fake_occlusion &o : occlusions) {
+		json.begin_object();
+		json.member("sourceName", o.source_name).member("region", o.region);
+		json.member("durationMs", o.duration_ms).member("active", o.active);
+		json.end_object();
+	}
+	json.end_array();
+
+	json.key("occludingSourceNames").begin_array();
+	for (const fake_occlusion &o : occlusions)
+		json.value(o.source_name);
+	json.end_array();
+
+	json.key("occlusionStats").begin_object().member("observedMs", 3600000).key("entries").begin_array();
+	for (const fake_occlusion &o : occlusions) {
+		json.begin_object();
+		json.member("sourceName", o.source_name).member("region", o.region);
+		json.member("totalMs", o.duration_ms).member("longestMs", o.duration_ms / 2);
+		json.member("fraction", 0.25f).member("active", o.active);
+		json.end_object();
+	}
+	json.end_array().end_object();
+
+	json.end_object();
+	json.end_object().end_object();
+}
+
+void noice::bench::run_json(runner &r)
+{
+	const options &opts = r.opts();
+
+	for (int64_t entry_count : opts.entries) {
+		std::mt19937 rng = noice::bench::rng(opts, (uint32_t)entry_count);
+		auto occlusions = make_occlusions(rng, (size_t)entry_count);
+
+		// Both have to describe the same document
+		std::string tree_body, writer_body;
+		build_tree(occlusions, tree_body);
+		build_writer(occlusions, writer_body);
+		if (nlohmann::json::parse(tree_body) != nlohmann::json::parse(writer_body))
+			r.fail("json_writer output differs from nlohmann::json for %" PRId64 " entries", entry_count);
+
+		// The writer itself only ever appends to the buffer, a warm one must not move
+		size_t capacity = writer_body.capacity();
+		const char *data = writer_body.data();
+		build_writer(occlusions, writer_body);
+		if (writer_body.capacity() != capacity || writer_body.data() != data)
+			r.fail("json_writer reallocated a warm buffer for %" PRId64 " entries", entry_count);
+
+		params_t params = {{"entries", entry_count}, {"bytes", (int64_t)writer_body.size()}};
+
+		std::string body;
+		r.run("json.diagnostics.nlohmann", params, writer_body.size(), [&]() {
+			build_tree(occlusions, body);
+			return (uint64_t)body.size();
+		});
+
+		body.reserve(writer_body.size());
+		r.run("json.diagnostics.writer", params, writer_body.size(), [&]() {
+			build_writer(occlusions, body);
+			return (uint64_t)body.size();
+		});
+	}
+}
@@ -0,0 +1,142 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "bench.hpp"
+#include "obs-stub.hpp"
+#include "validator-registry.hpp"
+#include <cstring>
+#include <memory>
+
+// Validator sources shared between the scenes, collections usually reuse one or a few
+static constexpr size_t VALIDATOR_SOURCES = 4;
+
+struct scene_graph {
+	std::vector<std::unique_ptr<obs_source>> sources;
+	std::vector<std::unique_ptr<obs_scene>> scenes;
+	std::vector<std::unique_ptr<obs_scene_item>> items;
+	std::vector<obs_source_t *> validators;
+};
+
+static obs_source_t *add_source(scene_graph &graph, const char *id)
+{
+	graph.sources.push_back(std::make_unique<obs_source>());
+	obs_source_t *source = graph.sources.back().get();
+	source->id = id;
+	source->scene = nullptr;
+	return source;
+}
+
+// Scenes of item_count inputs, three out of four showing one of the validators
+static void make_graph(scene_graph &graph, std::mt19937 &rng, size_t scene_count, size_t item_count)
+{
+	for (size_t i = 0; i < VALIDATOR_SOURCES; i++)
+		graph.validators.push_back(add_source(graph, "noice_validator"));
+
+	std::uniform_int_distribution<size_t> position(0, item_count - 1);
+	std::uniform_int_distribution<size_t> validator(0, VALIDATOR_SOURCES - 1);
+	for (size_t s = 0; s < scene_count; s++) {
+		graph.scenes.push_back(std::make_unique<obs_scene>());
+		obs_scene_t *scene = graph.scenes.back().get();
+		scene->source = add_source(graph, "scene");
+		scene->source->scene = scene;
+
+		size_t validator_at = s % 4 != 3 ? position(rng) : SIZE_MAX;
+		for (size_t i = 0; i < item_count; i++) {
+			graph.items.push_back(std::make_unique<obs_scene_item>());
+			obs_sceneitem_t *item = graph.items.back().get();
+			item->parent = scene;
+			item->source = i == validator_at ? graph.validators[validator(rng)] : add_source(graph, "image_source");
+			scene->items.push_back(item);
+		}
+	}
+}
+
+void noice::bench::run_registry(runner &r)
+{
+	const options &opts = r.opts();
+
+	for (int64_t scene_count : opts.scenes) {
+		for (int64_t item_count : opts.items) {
+			std::mt19937 rng = noice::bench::rng(opts, (uint32_t)(scene_count * 31 + item_count));
+			scene_graph graph;
+			make_graph(graph, rng, (size_t)scene_count, (size_t)item_count);
+			params_t params = {{"scenes", scene_count}, {"items", item_count}};
+
+			noice_bench_scenes.clear();
+			for (auto &scene : graph.scenes)
+				noice_bench_scenes.push_back(scene->source);
+
+			noice::source::validator_registry registry;
+			for (obs_source_t *validator : graph.validators)
+				registry.add(validator, nullptr);
+			// Scenes are scanned on first lookup, measure the lookups that follow
+			for (obs_source_t *scene : noice_bench_scenes)
+				registry.scene_has_validator(scene);
+
+			// Current scene check in tick_handler, the current scene moving between ticks
+			size_t current = 0;
+			r.run("registry.tick", params, 1, [&]() {
+				obs_source_t *scene = noice_bench_scenes[current++ % noice_bench_scenes.size()];
+				return (uint64_t)registry.scene_has_validator(scene);
+			});
+
+			// What tick_handler did before the registry, enumerating the items for the source id
+			current = 0;
+			r.run("registry.tick_scan", params, 1, [&]() {
+				obs_scene_t *scene = obs_scene_from_source(noice_bench_scenes[current++ % noice_bench_scenes.size()]);
+				bool found = false;
+				auto cb = [](obs_scene_t *, obs_sceneitem_t *item, void *param) -> bool {
+					const char *id = obs_source_get_id(obs_sceneitem_get_source(item));
+					if (id && !strcmp(id, "noice_validator")) {
+						*reinterpret_cast<bool *>(param) = true;
+						return false;
+					}
+					return true;
+				};
+				obs_scene_enum_items(scene, cb, &found);
+				return (uint64_t)found;
+			});
+
+			// Selected game propagation reaching every validator
+			r.run("registry.selected_game", params, (uint64_t)scene_count, [&]() {
+				uint64_t count = 0;
+				for (obs_source_t *source : registry.validators()) {
+					count++;
+					obs_source_release(source);
+				}
+				return count;
+			});
+
+			// Before the registry, every item of every scene was checked for the source id
+			r.run("registry.selected_game_scan", params, (uint64_t)scene_count, [&]() {
+				uint64_t count = 0;
+				auto cb = [](void *param, obs_source_t *source) {
+					auto cb = [](obs_scene_t *, obs_sceneitem_t *item, void *param) -> bool {
+						const char *id = obs_source_get_id(obs_sceneitem_get_source(item));
+						if (id && !strcmp(id, "noice_validator"))
+							(*reinterpret_cast<uint64_t *>(param))++;
+						return true;
+					};
+					obs_scene_enum_items(obs_scene_from_source(source), cb, param);
+					return true;
+				};
+				obs_enum_scenes(cb, &count);
+				return count;
+			});
+
+			noice_bench_scenes.clear();
+		}
+	}
+}
@@ -0,0 +1,170 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "bench.hpp"
+#include "scene-recording.hpp"
+#include "validation.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace validation = noice::validation;
+
+static constexpr double TWO_PI = 6.283185307179586;
+
+static validation::transform translation(float x, float y)
+{
+	return {{1.0f, 0.0f}, {0.0f, 1.0f}, {x, y}};
+}
+
+// Items drift on small circles and every fourth one also sways around its center, enough
+// movement for hits to start and stop like they do in a live scene
+static validation::transform animate(const validation::transform &box, size_t index, double phase, double t, float amplitude)
+{
+	double angle = TWO_PI * t + phase + (double)index * 0.7;
+	float dx = amplitude * (float)sin(angle), dy = amplitude * (float)cos(angle);
+	if (index % 4 != 0)
+		return validation::multiply(box, translation(dx, dy));
+
+	float rot = 0.09f * (float)sin(angle * 2.0);
+	float c = cosf(rot), s = sinf(rot);
+	validation::point center = validation::apply(box, {0.5f, 0.5f});
+	validation::transform sway = validation::multiply(translation(-center.x, -center.y), {{c, s}, {-s, c}, {0.0f, 0.0f}});
+	return validation::multiply(box, validation::multiply(sway, translation(center.x + dx, center.y + dy)));
+}
+
+static uint64_t frame_interval(const validation::video_info &video)
+{
+	if (video.fps_num == 0 || video.fps_den == 0)
+		return 1000000000 / 60;
+	return (uint64_t)1000000000 * video.fps_den / video.fps_num;
+}
+
+// Cycles through the recorded frames, one animation period over all generated frames
+static std::vector<std::shared_ptr<const validation::scene_snapshot>> animate_frames(const validation::scene_recording &recording,
+										     size_t count, double phase)
+{
+	float amplitude = 0.02f * (float)recording.video.base_width;
+	uint64_t interval = frame_interval(recording.video);
+
+	std::vector<std::shared_ptr<const validation::scene_snapshot>> frames;
+	frames.reserve(count);
+	for (size_t f = 0; f < count; f++) {
+		auto snapshot = validation::frame_snapshot(recording, recording.frames[f % recording.frames.size()]);
+		snapshot->frame_time = (f + 1) * interval;
+		double t = (double)f / (double)count;
+		for (size_t i = 0; i < snapshot->items.size(); i++) {
+			validation::item &it = snapshot->items[i];
+			it.box_transform = animate(it.box_transform, i, phase, t, amplitude);
+		}
+		frames.push_back(snapshot);
+	}
+	return frames;
+}
+
+// Every batch kernel has to agree with the exact per pair test on every item and frame
+static size_t check_kernels(const std::vector<std::shared_ptr<const validation::scene_snapshot>> &frames,
+			    const std::vector<validation::region> &regions)
+{
+	validation::region_batch batch(regions);
+	validation::kernel best = validation::detect_kernel();
+	std::vector<validation::kernel> kernels = {validation::kernel::scalar};
+	if (best != validation::kernel::scalar)
+		kernels.push_back(validation::kernel::sse2);
+	if (best == validation::kernel::avx2)
+		kernels.push_back(validation::kernel::avx2);
+
+	size_t mismatches = 0;
+	for (auto &frame : frames) {
+		for (const validation::item &it : frame->items) {
+			for (size_t block = 0; block < batch.blocks(); block++) {
+				uint32_t expected = 0;
+				for (size_t i = block * validation::region_batch::BLOCK_SIZE;
+				     i < std::min(regions.size(), (block + 1) * validation::region_batch::BLOCK_SIZE); i++) {
+					if (validation::item_in_region(it.box_transform, regions[i].box))
+						expected |= 1u << (i % validation::region_batch::BLOCK_SIZE);
+				}
+				for (validation::kernel k : kernels) {
+					if (validation::item_in_region_block(it.box_transform, batch, block, k) != expected)
+						mismatches++;
+				}
+			}
+		}
+	}
+	return mismatches;
+}
+
+void noice::bench::run_replay(runner &r)
+{
+	const options &opts = r.opts();
+
+	for (size_t index = 0; index < opts.replay.size(); index++) {
+		const std::string &path = opts.replay[index];
+		std::ifstream file(path, std::ios::in | std::ios::binary);
+		validation::scene_recording recording;
+		if (!file.is_open() || !validation::read_recording(file, recording)) {
+			r.fail("%s is not a readable scene recording", path.c_str());
+			continue;
+		}
+		if (recording.frames.empty()) {
+			r.fail("%s has no frames", path.c_str());
+			continue;
+		}
+
+		std::mt19937 rng = noice::bench::rng(opts, (uint32_t)index);
+		auto frames = animate_frames(recording, (size_t)opts.frames, std::uniform_real_distribution<double>(0.0, TWO_PI)(rng));
+		auto regions = std::make_shared<const std::vector<validation::region>>(recording.regions);
+
+		size_t items = recording.frames[0].items.size();
+		size_t validated = frames[0]->items.size();
+		fprintf(stderr, "%s: %ux%u canvas, %zu recorded frames, %zu items (%zu validated), %zu source types, %zu regions\n",
+			path.c_str(), recording.video.base_width, recording.video.base_height, recording.frames.size(), items, validated,
+			recording.source_types.size(), regions->size());
+
+		size_t mismatches = check_kernels(frames, *regions);
+		if (mismatches > 0)
+			r.fail("%s: %zu batch kernel results differ from item_in_region", path.c_str(), mismatches);
+
+		params_t params = {{"recording", (int64_t)index},
+				   {"items", (int64_t)validated},
+				   {"regions", (int64_t)regions->size()},
+				   {"frames", opts.frames}};
+		validation::options vopts;
+
+		r.run("replay.validate", params, frames.size(), [&]() {
+			uint64_t hits = 0;
+			for (auto &frame : frames) {
+				auto res = validation::validate(frame, regions, vopts, frame->frame_time);
+				hits += res->items.size();
+			}
+			return hits;
+		});
+
+		// Validation plus the occlusion tracking a validator does with every result
+		uint64_t events = 0;
+		validation::engine engine(nullptr, [&events](const validation::occlusion_event &) {
+			events++;
+			return true;
+		});
+		// Every pass continues the clock where the previous one stopped
+		uint64_t offset = 0;
+		r.run("replay.engine", params, frames.size(), [&]() {
+			for (auto &frame : frames)
+				engine.submit(frame, regions, vopts, offset + frame->frame_time);
+			offset += frames.back()->frame_time;
+			return events;
+		});
+	}
+}
@@ -0,0 +1,70 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "bench.hpp"
+#include "scene-collection.hpp"
+#include <cstdio>
+#include <sstream>
+#include <nlohmann/json.hpp>
+
+// Streamlabs scene collection with one scene per ten sources, items carry the extra
+// settings real collections have so parsing isn't measured on a trimmed down file
+static std::string make_collection(std::mt19937 &rng, size_t source_count)
+{
+	std::uniform_int_distribution<uint32_t> id;
+	auto make_id = [&rng, &id](const char *prefix) {
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), "%s_%08x-%04x-%04x", prefix, id(rng), id(rng) & 0xffff, id(rng) & 0xffff);
+		return std::string(buffer);
+	};
+
+	nlohmann::json sources = nlohmann::json::array();
+	for (size_t i = 0; i < source_count; i++) {
+		sources.push_back({{"id", make_id("image_source")},
+				   {"name", "Source " + std::to_string(i)},
+				   {"type", "image_source"},
+				   {"settings", {{"file", "C:/overlays/overlay" + std::to_string(i) + ".png"}, {"unload", false}}},
+				   {"volume", 1},
+				   {"channel", 0}});
+	}
+
+	nlohmann::json scenes = nlohmann::json::array();
+	for (size_t i = 0; i < source_count / 10 + 1; i++)
+		scenes.push_back({{"id", make_id("scene")}, {"name", "Scene " + std::to_string(i)}, {"items", nlohmann::json::array()}});
+
+	nlohmann::json collection = {
+		{"sources", {{"items", sources}}},
+		{"scenes", {{"items", scenes}}},
+	};
+	return collection.dump();
+}
+
+void noice::bench::run_scenecollection(runner &r)
+{
+	const options &opts = r.opts();
+
+	for (int64_t source_count : opts.sources) {
+		std::mt19937 rng = noice::bench::rng(opts, (uint32_t)source_count);
+		std::string collection = make_collection(rng, (size_t)source_count);
+		params_t params = {{"sources", source_count}, {"bytes", (int64_t)collection.size()}};
+
+		r.run("scenecollection.parse", params, (uint64_t)source_count, [&]() {
+			std::istringstream input(collection);
+			noice::source::scenecollection_names names;
+			noice::source::parse_scenecollection(input, names);
+			return (uint64_t)names.guid2source.size();
+		});
+	}
+}
@@ -0,0 +1,251 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "bench.hpp"
+#include "validation.hpp"
+#include "version.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+// Set by --verbose, read by the libobs stub
+bool noice_bench_verbose = false;
+
+// Samples are batched to at least this long so timer overhead stays negligible
+static constexpr double MIN_SAMPLE_NS = 20000.0;
+static constexpr size_t MIN_SAMPLES = 10;
+static constexpr size_t MAX_SAMPLES = 100000;
+
+static volatile uint64_t sink_value;
+
+noice::bench::options::options() : min_time(200), seed(1), verbose(false), frames(240)
+{
+	items = {16, 64, 256};
+	regions = {8, 32, 64};
+	games = {10, 100};
+	sources = {100, 1000, 10000};
+	entries = {8, 32, 128};
+	scenes = {500};
+}
+
+bool noice::bench::runner::selected(const std::string &name) const
+{
+	return _opts.filter.empty() || name.find(_opts.filter) != std::string::npos;
+}
+
+double noice::bench::runner::sample(const std::function<uint64_t()> &fn, uint64_t batch, uint64_t &sink)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t i = 0; i < batch; i++)
+		sink += fn();
+	auto end = std::chrono::steady_clock::now();
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / (double)batch;
+}
+
+void noice::bench::runner::run(const std::string &name, const params_t &params, uint64_t units, const std::function<uint64_t()> &fn)
+{
+	if (!selected(name))
+		return;
+
+	uint64_t sink = 0;
+	double warmup = sample(fn, 1, sink);
+
+	uint64_t batch = warmup > 0.0 ? (uint64_t)std::max(1.0, MIN_SAMPLE_NS / warmup) : 1000;
+	double budget = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(_opts.min_time).count();
+
+	std::vector<double> samples;
+	double total = 0.0;
+	while (samples.size() < MAX_SAMPLES && (samples.size() < MIN_SAMPLES || total < budget)) {
+		double ns = sample(fn, batch, sink);
+		samples.push_back(ns);
+		total += ns * (double)batch;
+	}
+	sink_value = sink;
+
+	std::sort(samples.begin(), samples.end());
+	result res;
+	res.name = name;
+	res.params = params;
+	res.units = units;
+	res.iterations = samples.size() * batch;
+	res.mean = total / (double)res.iterations;
+	res.min = samples.front();
+	res.p50 = samples[(samples.size() - 1) / 2];
+	res.p95 = samples[(samples.size() - 1) * 95 / 100];
+	res.max = samples.back();
+	_results.push_back(res);
+
+	std::string label = name;
+	for (auto &param : params)
+		label += " " + param.first + "=" + std::to_string(param.second);
+	fprintf(stderr, "%-64s %12.1f ns %12.2f ns/unit\n", label.c_str(), res.p50, res.p50 / (double)std::max<uint64_t>(units, 1));
+}
+
+void noice::bench::runner::fail(const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	fprintf(stderr, "FAILED: ");
+	vfprintf(stderr, format, args);
+	fprintf(stderr, "\n");
+	va_end(args);
+	_failures++;
+}
+
+static bool parse_list(const char *value, std::vector<int64_t> &out)
+{
+	std::vector<int64_t> list;
+	std::string text(value);
+	size_t pos = 0;
+	while (pos <= text.size()) {
+		size_t end = text.find(',', pos);
+		if (end == std::string::npos)
+			end = text.size();
+		try {
+			long long number = std::stoll(text.substr(pos, end - pos));
+			if (number <= 0)
+				return false;
+			list.push_back(number);
+		} catch (...) {
+			return false;
+		}
+		pos = end + 1;
+	}
+	out = list;
+	return !out.empty();
+}
+
+static void usage()
+{
+	fprintf(stderr,
+		"Usage: noice-bench [options]\n"
+		"  --filter TEXT      only run benchmarks whose name contains TEXT\n"
+		"  --min-time MS      minimum measuring time per benchmark (default 200)\n"
+		"  --seed N           seed of the synthetic scenes and catalogs (default 1)\n"
+		"  --items LIST       scene item counts, e.g. 16,64,256\n"
+		"  --regions LIST     region counts per game\n"
+		"  --games LIST       catalog sizes in games\n"
+		"  --sources LIST     scene collection sizes in sources\n"
+		"  --entries LIST     occlusion entries in diagnostics bodies\n"
+		"  --scenes LIST      scene counts of the validator registry benchmarks\n"
+		"  --replay FILE      replay a scene recording, may be repeated\n"
+		"  --frames N         animated frames per replayed recording (default 240)\n"
+		"  --output FILE      write the JSON results to FILE instead of stdout\n"
+		"  --verbose          show plugin log output\n");
+}
+
+int main(int argc, char **argv)
+{
+	noice::bench::options opts;
+	std::string output;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+		bool ok = true;
+
+		if (arg == "--verbose") {
+			opts.verbose = true;
+			continue;
+		} else if (arg == "--help" || arg == "-h") {
+			usage();
+			return 0;
+		} else if (!value) {
+			ok = false;
+		} else if (arg == "--filter") {
+			opts.filter = value;
+		} else if (arg == "--min-time") {
+			opts.min_time = std::chrono::milliseconds(std::max(1, atoi(value)));
+		} else if (arg == "--seed") {
+			opts.seed = (uint32_t)strtoul(value, nullptr, 10);
+		} else if (arg == "--items") {
+			ok = parse_list(value, opts.items);
+		} else if (arg == "--regions") {
+			ok = parse_list(value, opts.regions);
+		} else if (arg == "--games") {
+			ok = parse_list(value, opts.games);
+		} else if (arg == "--sources") {
+			ok = parse_list(value, opts.sources);
+		} else if (arg == "--entries") {
+			ok = parse_list(value, opts.entries);
+		} else if (arg == "--scenes") {
+			ok = parse_list(value, opts.scenes);
+		} else if (arg == "--replay") {
+			opts.replay.push_back(value);
+		} else if (arg == "--frames") {
+			opts.frames = std::max(1, atoi(value));
+		} else if (arg == "--output") {
+			output = value;
+		} else {
+			ok = false;
+		}
+
+		if (!ok) {
+			fprintf(stderr, "Invalid argument: %s\n", arg.c_str());
+			usage();
+			return 1;
+		}
+		i++;
+	}
+	noice_bench_verbose = opts.verbose;
+
+	noice::bench::runner runner(opts);
+	noice::bench::run_geometry(runner);
+	noice::bench::run_catalog(runner);
+	noice::bench::run_scenecollection(runner);
+	noice::bench::run_json(runner);
+	noice::bench::run_replay(runner);
+	noice::bench::run_registry(runner);
+
+	nlohmann::json results = nlohmann::json::array();
+	for (const noice::bench::result &res : runner.results()) {
+		nlohmann::json params = nlohmann::json::object();
+		for (auto &param : res.params)
+			params[param.first] = param.second;
+
+		results.push_back({{"name", res.name},
+				   {"params", params},
+				   {"units", res.units},
+				   {"iterations", res.iterations},
+				   {"mean_ns", res.mean},
+				   {"min_ns", res.min},
+				   {"p50_ns", res.p50},
+				   {"p95_ns", res.p95},
+				   {"max_ns", res.max}});
+	}
+
+	nlohmann::json report = {
+		{"version", PROJECT_VERSION},
+		{"kernel", noice::validation::kernel_name(noice::validation::detect_kernel())},
+		{"seed", opts.seed},
+		{"results", results},
+	};
+
+	if (output.empty()) {
+		std::cout << report.dump(2) << std::endl;
+	} else {
+		std::ofstream file(output, std::ios::out | std::ios::trunc);
+		file << report.dump(2) << std::endl;
+		if (!file.good()) {
+			fprintf(stderr, "Failed to write %s\n", output.c_str());
+			return 1;
+		}
+	}
+	return runner.failures() > 0 ? 1 : 0;
+}
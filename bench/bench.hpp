@@ -0,0 +1,105 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <chrono>
+#include <cinttypes>
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "util/util-log.hpp"
+
+namespace noice::bench {
+
+typedef std::vector<std::pair<std::string, int64_t>> params_t;
+
+struct result {
+	std::string name;
+	params_t params;
+	// Work units (items, pairs, bytes...) handled per iteration
+	uint64_t units;
+	uint64_t iterations;
+	// Nanoseconds per iteration
+	double mean;
+	double min;
+	double p50;
+	double p95;
+	double max;
+};
+
+struct options {
+	std::string filter;
+	std::chrono::milliseconds min_time;
+	uint32_t seed;
+	bool verbose;
+
+	std::vector<int64_t> items;
+	std::vector<int64_t> regions;
+	std::vector<int64_t> games;
+	std::vector<int64_t> sources;
+	std::vector<int64_t> entries;
+	std::vector<int64_t> scenes;
+
+	// Scene recordings to replay, and the animated frames generated from each
+	std::vector<std::string> replay;
+	int64_t frames;
+
+	options();
+};
+
+// Runs benchmarks and collects their results
+class runner {
+	options _opts;
+	std::vector<result> _results;
+	size_t _failures;
+
+	// Runs fn batch times, returns nanoseconds per iteration
+	static double sample(const std::function<uint64_t()> &fn, uint64_t batch, uint64_t &sink);
+
+public:
+	runner(const options &opts) : _opts(opts), _failures(0) {}
+
+	const options &opts() const { return _opts; }
+
+	bool selected(const std::string &name) const;
+
+	// Times fn, which runs one iteration and returns anything derived from its work so
+	// the compiler can't drop it
+	void run(const std::string &name, const params_t &params, uint64_t units, const std::function<uint64_t()> &fn);
+
+	const std::vector<result> &results() const { return _results; }
+
+	// Reports a failed check, the run then exits with an error
+	void fail(const char *format, ...) NOICE_LOG_PRINTF(2, 3);
+
+	size_t failures() const { return _failures; }
+};
+
+// Fixed seed per benchmark so runs and releases measure the same synthetic data
+inline std::mt19937 rng(const options &opts, uint32_t salt)
+{
+	return std::mt19937(opts.seed ^ (salt * 0x9e3779b9u));
+}
+
+void run_geometry(runner &r);
+void run_catalog(runner &r);
+void run_scenecollection(runner &r);
+void run_json(runner &r);
+void run_replay(runner &r);
+void run_registry(runner &r);
+
+} // namespace noice::bench
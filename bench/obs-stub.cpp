@@ -0,0 +1,133 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// The few libobs functions the benchmarked code calls, so noice-bench runs without
+// libobs or a running OBS. Only the libobs headers are needed to build.
+
+#include "obs-stub.hpp"
+#include <obs-module.h>
+#include <util/base.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+
+extern bool noice_bench_verbose;
+
+std::vector<obs_source_t *> noice_bench_scenes;
+
+void blog(int log_level, const char *format, ...)
+{
+	if (!noice_bench_verbose)
+		return;
+
+	va_list args;
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	fputc('\n', stderr);
+	va_end(args);
+}
+
+uint64_t os_gettime_ns(void)
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+void os_set_thread_name(const char *name) {}
+
+const char *obs_module_text(const char *lookup_string)
+{
+	return lookup_string;
+}
+
+// Scenes, see obs-stub.hpp
+
+bool calldata_get_data(const calldata_t *data, const char *name, void *out, size_t size)
+{
+	return false;
+}
+
+void signal_handler_connect(signal_handler_t *handler, const char *signal, signal_callback_t callback, void *data) {}
+
+void signal_handler_disconnect(signal_handler_t *handler, const char *signal, signal_callback_t callback, void *data) {}
+
+signal_handler_t *obs_source_get_signal_handler(const obs_source_t *source)
+{
+	return nullptr;
+}
+
+const char *obs_source_get_id(const obs_source_t *source)
+{
+	return source->id.c_str();
+}
+
+obs_source_t *obs_source_get_ref(obs_source_t *source)
+{
+	return source;
+}
+
+void obs_source_release(obs_source_t *source) {}
+
+void obs_enum_scenes(bool (*enum_proc)(void *, obs_source_t *), void *param)
+{
+	for (obs_source_t *source : noice_bench_scenes) {
+		if (!enum_proc(param, source))
+			break;
+	}
+}
+
+obs_scene_t *obs_scene_from_source(const obs_source_t *source)
+{
+	return source && source->id == "scene" ? source->scene : nullptr;
+}
+
+obs_scene_t *obs_group_or_scene_from_source(const obs_source_t *source)
+{
+	return source ? source->scene : nullptr;
+}
+
+obs_source_t *obs_scene_get_source(const obs_scene_t *scene)
+{
+	return scene ? scene->source : nullptr;
+}
+
+void obs_scene_enum_items(obs_scene_t *scene, bool (*callback)(obs_scene_t *, obs_sceneitem_t *, void *), void *param)
+{
+	for (obs_sceneitem_t *item : scene->items) {
+		if (!callback(scene, item, param))
+			break;
+	}
+}
+
+obs_source_t *obs_sceneitem_get_source(const obs_sceneitem_t *item)
+{
+	return item->source;
+}
+
+bool obs_sceneitem_is_group(obs_sceneitem_t *item)
+{
+	return item->source->id == "group";
+}
+
+obs_scene_t *obs_sceneitem_group_get_scene(const obs_sceneitem_t *group)
+{
+	return group->source->id == "group" ? group->source->scene : nullptr;
+}
+
+void obs_sceneitem_addref(obs_sceneitem_t *item) {}
+
+void obs_sceneitem_release(obs_sceneitem_t *item) {}
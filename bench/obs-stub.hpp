@@ -0,0 +1,41 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <obs.h>
+#include <string>
+#include <vector>
+
+// Scene graph behind the stubbed scene functions, benchmarks build it directly. Nothing is
+// reference counted, the benchmark owning the graph frees it.
+struct obs_source {
+	// "scene", "group" or the input id
+	std::string id;
+	// Set for scenes and groups
+	obs_scene_t *scene;
+};
+
+struct obs_scene {
+	obs_source_t *source;
+	std::vector<obs_sceneitem_t *> items;
+};
+
+struct obs_scene_item {
+	obs_scene_t *parent;
+	obs_source_t *source;
+};
+
+// What obs_enum_scenes lists
+extern std::vector<obs_source_t *> noice_bench_scenes;
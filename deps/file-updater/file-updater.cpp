@@ -5,6 +5,8 @@
 #include <util/dstr.h>
 #include <obs-data.h>
 #include "file-updater.hpp"
+#include "util/util-trace.hpp"
+#include "util/util-sha256.hpp"
 
 #define warn(msg, ...) \
 	blog(LOG_WARNING, "%s" msg, info->log_prefix, ##__VA_ARGS__)
@@ -15,6 +17,9 @@ struct update_info {
 	char error[CURL_ERROR_SIZE];
 	struct curl_slist *header;
 	DARRAY(uint8_t) file_data;
+	/* set while a file is streamed to disk instead of into file_data */
+	FILE *download_file;
+	noice::util::sha256 *download_hash;
 	char *user_agent;
 	CURL *curl;
 	char *url;
@@ -23,6 +28,8 @@ struct update_info {
 	char *local;
 	char *cache;
 	char *temp;
+	/* content addressed files shared by all caches, may be NULL */
+	char *store;
 
 	const char *remote_url;
 	obs_data_t *local_package;
@@ -48,6 +55,7 @@ void update_info_destroy(struct update_info *info)
 	bfree(info->user_agent);
 	bfree(info->temp);
 	bfree(info->cache);
+	bfree(info->store);
 	bfree(info->local);
 	bfree(info->url);
 
@@ -68,9 +76,16 @@ static size_t http_write(uint8_t *ptr, size_t size, size_t nmemb,
 			 struct update_info *info)
 {
 	size_t total = size * nmemb;
-	if (total)
-		da_push_back_array(info->file_data, ptr, total);
+	if (!total)
+		return 0;
 
+	if (info->download_file) {
+		info->download_hash->update(ptr, total);
+		/* a short write aborts the transfer */
+		return fwrite(ptr, 1, total, info->download_file);
+	}
+
+	da_push_back_array(info->file_data, ptr, total);
 	return total;
 }
 
@@ -102,6 +117,7 @@ static size_t http_header(char *buffer, size_t size, size_t nitems,
 static bool do_http_request(struct update_info *info, const char *url,
 			    long *response_code)
 {
+	NOICE_TRACE_SCOPE("file_updater.http_request");
 	CURLcode code;
 	uint8_t null_terminator = 0;
 
@@ -173,6 +189,7 @@ static inline obs_data_t *get_package(const char *base_path, const char *file)
 
 static bool init_update(struct update_info *info)
 {
+	NOICE_TRACE_SCOPE("file_updater.init");
 	struct dstr user_agent = {};
 
 	info->curl = curl_easy_init();
@@ -289,6 +306,7 @@ static bool update_files_to_local(void *param, obs_data_t *local_file)
 
 static int update_local_version(struct update_info *info)
 {
+	NOICE_TRACE_SCOPE("file_updater.local_version");
 	int local_version;
 	int cache_version = 0;
 
@@ -310,14 +328,141 @@ static int update_local_version(struct update_info *info)
 	return cache_version;
 }
 
-static inline bool do_relative_http_request(struct update_info *info,
-					    const char *url, const char *file)
+/* Streams the response body into temp_path while hashing it, so package
+ * files never have to be held in memory. On success hex receives the
+ * SHA-256 of the body, on failure the partial file is removed. */
+static bool do_relative_http_download(struct update_info *info,
+				      const char *url, const char *file,
+				      const char *temp_path,
+				      char hex[noice::util::sha256::HEX_SIZE])
 {
-	long response_code;
+	NOICE_TRACE_SCOPE("file_updater.http_download");
+	noice::util::sha256 hash;
+	long response_code = 0;
+	bool success;
+
+	FILE *f = os_fopen(temp_path, "wb");
+	if (!f) {
+		warn("Could not open temporary file '%s'", temp_path);
+		return false;
+	}
+
+	info->download_file = f;
+	info->download_hash = &hash;
+
 	char *full_url = get_path(url, file);
-	bool success = do_http_request(info, full_url, &response_code);
+	success = do_http_request(info, full_url, &response_code);
 	bfree(full_url);
-	return success && response_code == 200;
+
+	info->download_file = NULL;
+	info->download_hash = NULL;
+
+	if (fclose(f) != 0) {
+		warn("Could not write temporary file '%s'", temp_path);
+		success = false;
+	}
+
+	if (!success || response_code != 200) {
+		os_unlink(temp_path);
+		return false;
+	}
+
+	hash.finish_hex(hex);
+	return true;
+}
+
+/* Store entries are named by the lowercase hex digest of their content */
+static bool store_name(const char *hash,
+		       char name[noice::util::sha256::HEX_SIZE])
+{
+	size_t len = hash ? strlen(hash) : 0;
+	if (len != noice::util::sha256::HEX_SIZE - 1)
+		return false;
+
+	for (size_t i = 0; i < len; i++) {
+		char c = hash[i];
+		if (c >= 'A' && c <= 'F')
+			c = (char)(c - 'A' + 'a');
+		else if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')))
+			return false;
+		name[i] = c;
+	}
+	name[len] = 0;
+	return true;
+}
+
+/* Copies a store entry to temp_path, re-hashing it on the way so a
+ * damaged entry is dropped and downloaded again instead of installed. */
+static bool copy_from_store(struct update_info *info, const char *name,
+			    const char *temp_path)
+{
+	NOICE_TRACE_SCOPE("file_updater.store_copy");
+	noice::util::sha256 hash;
+	char hex[noice::util::sha256::HEX_SIZE];
+	uint8_t chunk[16384];
+	bool success = true;
+
+	char *store_path = get_path(info->store, name);
+	FILE *in = os_fopen(store_path, "rb");
+	if (!in) {
+		bfree(store_path);
+		return false;
+	}
+
+	FILE *out = os_fopen(temp_path, "wb");
+	if (!out) {
+		fclose(in);
+		bfree(store_path);
+		return false;
+	}
+
+	size_t read;
+	while ((read = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+		hash.update(chunk, read);
+		if (fwrite(chunk, 1, read, out) != read) {
+			success = false;
+			break;
+		}
+	}
+	if (ferror(in))
+		success = false;
+	fclose(in);
+	if (fclose(out) != 0)
+		success = false;
+
+	hash.finish_hex(hex);
+	if (success && strcmp(hex, name) != 0) {
+		warn("Stored file '%s' is damaged, removing it", name);
+		os_unlink(store_path);
+		success = false;
+	}
+
+	if (!success)
+		os_unlink(temp_path);
+	bfree(store_path);
+	return success;
+}
+
+/* Keeps a copy of a verified download so other deployments listing the
+ * same content don't have to fetch it again */
+static void add_to_store(struct update_info *info, const char *temp_path,
+			 const char *name)
+{
+	char *store_path = get_path(info->store, name);
+	if (!os_file_exists(store_path)) {
+		struct dstr partial = {};
+		dstr_copy(&partial, store_path);
+		dstr_cat(&partial, ".part");
+
+		if (os_copyfile(temp_path, partial.array) != 0 ||
+		    os_rename(partial.array, store_path) != 0) {
+			warn("Could not add '%s' to the file store", name);
+			os_unlink(partial.array);
+		}
+
+		dstr_free(&partial);
+	}
+	bfree(store_path);
 }
 
 static inline void write_file_data(struct update_info *info,
@@ -335,7 +480,10 @@ static inline void replace_file(const char *src_base_path,
 	char *src_path = get_path(src_base_path, file);
 	char *dst_path = get_path(dst_base_path, file);
 
-	if (src_path && dst_path) {
+	/* os_rename replaces an existing file atomically, so readers see
+	 * either the old or the new version. Only fall back to unlinking
+	 * first if the platform refused to replace it. */
+	if (src_path && dst_path && os_rename(src_path, dst_path) != 0) {
 		os_unlink(dst_path);
 		os_rename(src_path, dst_path);
 	}
@@ -346,6 +494,7 @@ static inline void replace_file(const char *src_base_path,
 
 static bool update_remote_files(void *param, obs_data_t *remote_file)
 {
+	NOICE_TRACE_SCOPE("file_updater.remote_file");
 	struct update_info *info = (struct update_info *)param;
 
 	struct file_update_data data = {};
@@ -356,33 +505,69 @@ static bool update_remote_files(void *param, obs_data_t *remote_file)
 	if (!data.newer && data.found)
 		return true;
 
-	if (!do_relative_http_request(info, info->remote_url, data.name))
-		return true;
+	char *temp_path = get_path(info->temp, data.name);
+	char hex[noice::util::sha256::HEX_SIZE];
+	char expected[noice::util::sha256::HEX_SIZE];
+	const char *hash = obs_data_get_string(remote_file, "hash");
+	bool has_hash = hash && *hash;
+
+	if (has_hash && !store_name(hash, expected)) {
+		warn("Update file '%s' (version %d) has an invalid hash '%s'",
+		     data.name, data.version, hash);
+		has_hash = false;
+	}
+
+	/* content that any deployment already fetched is reused as is */
+	bool from_store = has_hash && info->store &&
+			  copy_from_store(info, expected, temp_path);
+
+	if (!from_store) {
+		if (!do_relative_http_download(info, info->remote_url,
+					       data.name, temp_path, hex)) {
+			bfree(temp_path);
+			return true;
+		}
+
+		/* files listed with a hash must match it byte for byte */
+		if (has_hash && strcmp(expected, hex) != 0) {
+			warn("Update file '%s' (version %d) hash mismatch, "
+			     "expected %s got %s",
+			     data.name, data.version, expected, hex);
+			os_unlink(temp_path);
+			bfree(temp_path);
+			return true;
+		}
+	}
 
 	if (info->callback) {
-		struct file_download_data download_data;
+		struct file_download_data download_data = {};
 		bool confirm;
 
 		download_data.name = data.name;
 		download_data.version = data.version;
-		download_data.buffer.da = info->file_data.da;
+		download_data.path = temp_path;
 
 		confirm = info->callback(info->param, &download_data);
 
-		info->file_data.da = download_data.buffer.da;
-
 		if (!confirm) {
 			info("Update file '%s' (version %d) rejected",
 			     data.name, data.version);
+			os_unlink(temp_path);
+			bfree(temp_path);
 			return true;
 		}
 	}
 
-	write_file_data(info, info->temp, data.name);
+	/* only content verified against the manifest is shared, otherwise
+	 * every unhashed file would add an entry nobody ever looks up */
+	if (has_hash && !from_store && info->store)
+		add_to_store(info, temp_path, hex);
+
+	bfree(temp_path);
 	replace_file(info->temp, info->cache, data.name);
 
-	info("Successfully updated file '%s' (version %d)", data.name,
-	     data.version);
+	info("Successfully updated file '%s' (version %d)%s", data.name,
+	     data.version, from_store ? " from the file store" : "");
 	return true;
 }
 
@@ -407,6 +592,7 @@ static void update_save_metadata(struct update_info *info)
 
 static void update_remote_version(struct update_info *info, int cur_version)
 {
+	NOICE_TRACE_SCOPE("file_updater.remote_version");
 	int remote_version;
 	long response_code;
 
@@ -474,7 +660,7 @@ static void *update_thread(void *data)
 update_info_t *update_info_create(const char *log_prefix,
 				  const char *user_agent,
 				  const char *update_url, const char *local_dir,
-				  const char *cache_dir,
+				  const char *cache_dir, const char *store_dir,
 				  confirm_file_callback_t confirm_callback,
 				  void *param)
 {
@@ -508,6 +694,14 @@ update_info_t *update_info_create(const char *log_prefix,
 	info->temp = dir.array;
 	info->local = bstrdup(local_dir);
 	info->cache = bstrdup(cache_dir);
+	if (store_dir) {
+		if (os_mkdirs(store_dir) < 0)
+			blog(LOG_WARNING,
+			     "%sCould not create store directory %s",
+			     log_prefix, store_dir);
+		else
+			info->store = bstrdup(store_dir);
+	}
 	info->url = get_path(update_url, "package.json");
 	info->callback = confirm_callback;
 	info->param = param;
@@ -518,6 +712,7 @@ update_info_t *update_info_create(const char *log_prefix,
 
 static void *single_file_thread(void *data)
 {
+	NOICE_TRACE_SCOPE("file_updater.single_file");
 	struct update_info *info = (struct update_info *)data;
 	struct file_download_data download_data;
 	long response_code;
@@ -535,6 +730,7 @@ static void *single_file_thread(void *data)
 
 	download_data.name = info->url;
 	download_data.version = 0;
+	download_data.path = NULL;
 	download_data.buffer.da = info->file_data.da;
 	info->callback(info->param, &download_data);
 	info->file_data.da = download_data.buffer.da;
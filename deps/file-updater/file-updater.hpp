@@ -10,16 +10,21 @@ struct file_download_data {
 	const char *name;
 	int version;
 
+	/* package files are streamed to this temporary path and the buffer
+	 * stays empty, single file downloads leave it NULL */
+	const char *path;
 	DARRAY(uint8_t) buffer;
 };
 
 typedef bool (*confirm_file_callback_t)(void *param,
 					struct file_download_data *file);
 
+/* store_dir, when set, holds downloaded files named by their SHA-256 and is
+ * consulted before downloading any package file that lists a "hash" */
 update_info_t *update_info_create(const char *log_prefix,
 				  const char *user_agent,
 				  const char *update_url, const char *local_dir,
-				  const char *cache_dir,
+				  const char *cache_dir, const char *store_dir,
 				  confirm_file_callback_t confirm_callback,
 				  void *param);
 update_info_t *update_info_create_single(
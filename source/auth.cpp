@@ -16,9 +16,9 @@
 #include "auth.hpp"
 #include "common.hpp"
 #include <util/util-curl.hpp>
+#include <util/util-json.hpp>
 #include <nlohmann/json.hpp>
 #include <ctime>
-#include <sstream>
 #include <chrono>
 #include <regex>
 
@@ -117,7 +117,7 @@ std::shared_ptr<noice::auth> noice::auth::instance()
 	return noice::auth::_instance;
 }
 
-bool noice::auth::handle_signin_response(const std::string &res)
+bool noice::auth::handle_signin_response(std::string_view res)
 {
 	nlohmann::json json_res;
 
@@ -178,12 +178,13 @@ bool noice::auth::sign_in()
 	auto cfg = noice::configuration::instance();
 	std::string stream_key = cfg->stream_key();
 
-	nlohmann::json payload = {
-		{"streamKey", stream_key},
-		{"sessionTokenMode", "SESSION_TOKEN_MODE_RESPONSE"},
-	};
-
-	std::string json = payload.dump();
+	// Carries the stream key, local so it doesn't outlive the request
+	std::string body;
+	noice::util::json_writer json(body);
+	json.begin_object();
+	json.member("streamKey", stream_key);
+	json.member("sessionTokenMode", "SESSION_TOKEN_MODE_RESPONSE");
+	json.end_object();
 
 	std::string endpoint = noice::get_api_endpoint("v4/auth:signin");
 
@@ -191,18 +192,11 @@ bool noice::auth::sign_in()
 	c.set_option(CURLOPT_URL, endpoint);
 	c.set_option(CURLOPT_POST, true);
 	c.set_header("Content-Type", "application/json");
-	c.set_option(CURLOPT_POSTFIELDS, json.c_str());
-
-	std::ostringstream stream;
-
-	auto cb = [&stream](void *data, size_t size, size_t nmemb) -> size_t {
-		const char *res = reinterpret_cast<char *>(data);
-		stream.write(res, size * nmemb);
-
-		return size * nmemb;
-	};
+	c.set_option(CURLOPT_POSTFIELDSIZE, (long)json.str().size());
+	c.set_option(CURLOPT_POSTFIELDS, json.str().c_str());
 
-	c.set_write_callback(cb);
+	noice::util::curl_response response;
+	c.set_response(response);
 
 	CURLcode code = c.perform();
 	if (code != CURLE_OK) {
@@ -218,7 +212,7 @@ bool noice::auth::sign_in()
 		return false;
 	}
 
-	return this->handle_signin_response(stream.str());
+	return this->handle_signin_response(response.view());
 }
 
 bool noice::auth::refresh_token()
@@ -229,13 +223,13 @@ bool noice::auth::refresh_token()
 
 	DLOG_INFO("refreshing access token");
 
-	nlohmann::json payload = {
-		{"refreshToken", _refresh_token},
-		{"app", "noice_obs_plugin"},
-		{"clientId", _uid},
-	};
-
-	std::string json = payload.dump();
+	std::string body;
+	noice::util::json_writer json(body);
+	json.begin_object();
+	json.member("refreshToken", _refresh_token);
+	json.member("app", "noice_obs_plugin");
+	json.member("clientId", _uid);
+	json.end_object();
 
 	std::string endpoint = noice::get_api_endpoint("/v4/auth/session/session:refresh");
 
@@ -243,20 +237,13 @@ bool noice::auth::refresh_token()
 	c.set_option(CURLOPT_URL, endpoint);
 	c.set_option(CURLOPT_POST, true);
 	c.set_header("Content-Type", "application/json");
-	c.set_option(CURLOPT_POSTFIELDS, json.c_str());
+	c.set_option(CURLOPT_POSTFIELDSIZE, (long)json.str().size());
+	c.set_option(CURLOPT_POSTFIELDS, json.str().c_str());
 	c.set_option(CURLOPT_FOLLOWLOCATION, true);
 	c.set_option(CURLOPT_POSTREDIR, CURL_REDIR_POST_ALL);
 
-	std::ostringstream stream;
-
-	auto cb = [&stream](void *data, size_t size, size_t nmemb) -> size_t {
-		const char *res = reinterpret_cast<char *>(data);
-		stream.write(res, size * nmemb);
-
-		return size * nmemb;
-	};
-
-	c.set_write_callback(cb);
+	noice::util::curl_response response;
+	c.set_response(response);
 
 	CURLcode code = c.perform();
 	if (code != CURLE_OK) {
@@ -268,12 +255,13 @@ bool noice::auth::refresh_token()
 	c.get_info(CURLINFO_RESPONSE_CODE, response_code);
 
 	if (response_code != 200) {
-		DLOG_WARNING("token refresh request failed with response code: %ld response: %s", response_code, stream.str().c_str());
+		DLOG_WARNING("token refresh request failed with response code: %ld response: %.*s", response_code, (int)response.size(),
+			     response.data());
 		reset_access_token();
 		return false;
 	}
 
-	return handle_signin_response(stream.str());
+	return handle_signin_response(response.view());
 }
 
 std::optional<std::string> noice::auth::get_access_token()
@@ -18,6 +18,8 @@
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <string>
+#include <string_view>
 
 namespace noice {
 class auth {
@@ -37,7 +39,7 @@ private:
 	bool sign_in();
 	bool refresh_token();
 	void reset_access_token();
-	bool handle_signin_response(const std::string &res);
+	bool handle_signin_response(std::string_view res);
 	bool is_token_valid();
 	bool is_token_expired();
 
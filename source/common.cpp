@@ -28,6 +28,7 @@
 #include <util/platform.h>
 #include <nlohmann/json.hpp>
 #include <algorithm>
+#include <set>
 #include "file-updater/file-updater.hpp"
 #include "obs-bridge.hpp"
 #include "game.hpp"
@@ -38,6 +39,8 @@
 #define NOICE_DEPLOYMENT_DEV "dev"
 
 constexpr std::string_view CFG_UNIQUE_ID = "unique_id";
+constexpr std::string_view CFG_GAME_CATALOG_LAZY = "game_catalog.lazy";
+constexpr std::string_view CFG_GAME_CATALOG_CACHE_LIMIT_KB = "game_catalog.cache_limit_kb";
 constexpr std::string_view CFG_DEPLOYMENT = "deployment";
 
 static const char *configuration_signals[] = {
@@ -208,14 +211,22 @@ void noice::configuration::refresh(bool blocking)
 	}
 }
 
+// Package files arrive on disk, the single file mode still hands over a buffer
+static nlohmann::json parse_download_file(struct file_download_data *file)
+{
+	if (file->path) {
+		std::ifstream stream(file->path, std::ios::binary);
+		return nlohmann::json::parse(stream);
+	}
+	return nlohmann::json::parse((const char *)file->buffer.array);
+}
+
 static bool verify_download_file(void *param, struct file_download_data *file)
 {
 	// Only do basic verification for input
 	if (astrcmpi(file->name, "services.json") == 0) {
-		std::stringstream stream((char *)file->buffer.array);
-
 		try {
-			nlohmann::json data = nlohmann::json::parse(stream);
+			nlohmann::json data = parse_download_file(file);
 
 			nlohmann::json services = data["services"];
 			if (!services.is_array())
@@ -228,10 +239,8 @@ static bool verify_download_file(void *param, struct file_download_data *file)
 			return false;
 		}
 	} else if (astrcmpi(file->name, "regions.json") == 0) {
-		std::stringstream stream((char *)file->buffer.array);
-
 		try {
-			nlohmann::json data = nlohmann::json::parse(stream);
+			nlohmann::json data = parse_download_file(file);
 
 			nlohmann::json games = data["games"];
 			if (!games.is_array())
@@ -249,20 +258,67 @@ static bool verify_download_file(void *param, struct file_download_data *file)
 	return true;
 }
 
+// Drops store entries that no deployment's package.json refers to anymore
+static void prune_config_store(const char *store_dir)
+{
+	std::set<std::string> referenced;
+	for (const char *deployment : {NOICE_DEPLOYMENT_DEV, NOICE_DEPLOYMENT_STG, NOICE_DEPLOYMENT_PRD}) {
+		const char *package_json = noice::deployment_config_path_env("package.json", deployment);
+		std::ifstream stream(package_json, std::ios::in);
+		bfree((void *)package_json);
+		if (!stream.is_open())
+			continue;
+
+		try {
+			nlohmann::json package = nlohmann::json::parse(stream);
+			for (const auto &file : package.value("files", nlohmann::json::array())) {
+				std::string hash = file.value("hash", "");
+				std::transform(hash.begin(), hash.end(), hash.begin(), [](unsigned char c) { return (char)tolower(c); });
+				if (!hash.empty())
+					referenced.insert(hash);
+			}
+		} catch (std::exception const &ex) {
+			// Better to keep a few stale files than to delete live ones
+			DLOG_ERROR("Not pruning the config store: %s", ex.what());
+			return;
+		}
+	}
+
+	os_dir_t *dir = os_opendir(store_dir);
+	if (!dir)
+		return;
+
+	for (struct os_dirent *entry = os_readdir(dir); entry; entry = os_readdir(dir)) {
+		if (entry->directory || referenced.count(entry->d_name) > 0)
+			continue;
+
+		std::string path = noice::string_format("%s/%s", store_dir, entry->d_name);
+		if (os_unlink(path.c_str()) == 0)
+			DLOG_INFO("Pruned %s from the config store", entry->d_name);
+	}
+	os_closedir(dir);
+}
+
 void noice::configuration::refresh_main(bool check)
 {
 	const char *local_dir = obs_module_file("");
 	const char *cache_dir = noice::deployment_config_path("");
+	// Shared by all deployments, files that are identical across them are only downloaded once
+	const char *store_dir = obs_module_config_path("store");
 	std::string update_url = noice::get_package_endpoint("");
 
 	if (cache_dir && check) {
 		update_info_t *update_info = update_info_create(DLOG_PREFIX " ", NOICE_USER_AGENT, update_url.c_str(), local_dir, cache_dir,
-								verify_download_file, nullptr);
+								store_dir, verify_download_file, nullptr);
 		update_info_destroy(update_info);
+
+		if (store_dir)
+			prune_config_store(store_dir);
 	}
 
 	bfree((void *)local_dir);
 	bfree((void *)cache_dir);
+	bfree((void *)store_dir);
 
 	time_t services_ts = noice::deployment_config_ts("services.json");
 	if (_services_json_ts != services_ts) {
@@ -273,10 +329,33 @@ void noice::configuration::refresh_main(bool check)
 	time_t regions_ts = noice::deployment_config_ts("regions.json");
 	if (_regions_json_ts != regions_ts) {
 		_regions_json_ts = regions_ts;
-		noice::game_manager::instance()->refresh();
+		refresh_games();
 	}
 }
 
+void noice::configuration::refresh_games()
+{
+	auto data = get();
+	obs_data_set_default_bool(data.get(), CFG_GAME_CATALOG_LAZY.data(), true);
+	obs_data_set_default_int(data.get(), CFG_GAME_CATALOG_CACHE_LIMIT_KB.data(), noice::game_manager::DEFAULT_CACHE_LIMIT_KB);
+	bool lazy = obs_data_get_bool(data.get(), CFG_GAME_CATALOG_LAZY.data());
+	size_t cache_limit = (size_t)std::max(0LL, obs_data_get_int(data.get(), CFG_GAME_CATALOG_CACHE_LIMIT_KB.data())) * 1024;
+
+	// TODO: Could use noice_service_selected() to hilight when service is inactive though source labels, but..
+	std::string name_suffix;
+	if (!noice::is_production())
+		name_suffix = noice::string_format(" (%s)", deployment().c_str());
+
+	auto gm = noice::game_manager::instance();
+	gm->configure(lazy, cache_limit, name_suffix);
+
+	const char *conf = noice::deployment_config_path("regions.json");
+	std::ifstream regions_json(conf, std::ios::in);
+	gm->refresh_main(regions_json);
+	regions_json.close();
+	bfree((void *)conf);
+}
+
 static time_t get_modified_timestamp(const char *filename)
 {
 	struct stat stats;
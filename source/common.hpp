@@ -27,6 +27,10 @@
 
 #include <obs.h>
 
+#if NOICE_CORE
+#include "util/util-log.hpp"
+#endif
+
 #undef strtoll
 
 #define QT_UTF8(str) QString::fromUtf8(str)
@@ -39,7 +43,11 @@
 #else
 #define DLOG_PREFIX "[Noice]"
 #endif
+#if NOICE_CORE
+#define DLOG_(level, ...) NOICE_LOG(level, DLOG_PREFIX " " __VA_ARGS__)
+#else
 #define DLOG_(level, ...) blog(level, DLOG_PREFIX " " __VA_ARGS__)
+#endif
 #define DLOG_ERROR(...) DLOG_(LOG_ERROR, __VA_ARGS__)
 #define DLOG_WARNING(...) DLOG_(LOG_WARNING, __VA_ARGS__)
 #define DLOG_INFO(...) DLOG_(LOG_INFO, __VA_ARGS__)
@@ -144,6 +152,8 @@ public:
 private:
 	void refresh_main(bool check);
 
+	void refresh_games();
+
 	// Singleton
 private:
 	static std::shared_ptr<noice::configuration> _instance;
@@ -15,14 +15,22 @@
 
 #include "game.hpp"
 #include "common.hpp"
+#include "util/util-profiler.hpp"
 #include <math.h>
-#include <fstream>
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <iterator>
+#include <string_view>
 #include <nlohmann/json.hpp>
 #include <obs-module.h>
 
 #define VERBOSE_DEBUG 0
 
-static noice::box_tuple convert_box(noice::box_tuple box, noice::box_format in_fmt, noice::box_format out_fmt)
+// Plenty for a couple of canvas sizes times every HUD scale step
+constexpr size_t ALIGNMENT_CACHE_MAX_ENTRIES = 64;
+
+noice::box_tuple noice::convert_box(box_tuple box, box_format in_fmt, box_format out_fmt)
 {
 	float a1, a2, a3, a4;
 	std::tie(a1, a2, a3, a4) = box;
@@ -72,31 +80,56 @@ static noice::box_tuple convert_box(noice::box_tuple box, noice::box_format in_f
 	return result;
 }
 
+enum axis_rule { AXIS_NEAR = 0, AXIS_FAR = 1, AXIS_MIDDLE = 2, AXIS_NONE = 3 };
+
+// Anchor to alignment rule, indexed by [noice::align_axis][noice::anchor]
+static constexpr axis_rule anchor_axis_rules[2][15] = {
+	{AXIS_NEAR, AXIS_MIDDLE, AXIS_FAR, AXIS_NEAR, AXIS_MIDDLE, AXIS_FAR, AXIS_NEAR, AXIS_MIDDLE, AXIS_FAR, AXIS_NEAR, AXIS_MIDDLE,
+	 AXIS_FAR, AXIS_NONE, AXIS_NONE, AXIS_NONE},
+	{AXIS_NEAR, AXIS_NEAR, AXIS_NEAR, AXIS_MIDDLE, AXIS_MIDDLE, AXIS_MIDDLE, AXIS_FAR, AXIS_FAR, AXIS_FAR, AXIS_NONE, AXIS_NONE,
+	 AXIS_NONE, AXIS_NEAR, AXIS_MIDDLE, AXIS_FAR},
+};
+
+// Without offsets every rule reduces to
+//   p = scaled * ref_point * scale + img * img_size + ref * ref_size * scale + raw * ref_point
+struct axis_rule_coefficients {
+	float scaled, img, ref, raw;
+};
+
+static constexpr axis_rule_coefficients axis_rule_table[4] = {
+	{1.0f, 0.0f, 0.0f, 0.0f},   // AXIS_NEAR
+	{1.0f, 1.0f, -1.0f, 0.0f},  // AXIS_FAR
+	{1.0f, 0.5f, -0.5f, 0.0f},  // AXIS_MIDDLE
+	{0.0f, 0.0f, 0.0f, 1.0f},   // AXIS_NONE
+};
+
+static constexpr axis_rule get_axis_rule(noice::anchor alignment, noice::align_axis axis)
+{
+	if (axis != noice::X && axis != noice::Y)
+		throw std::invalid_argument("axis");
+	if (alignment < noice::TOP_LEFT || alignment > noice::BOTTOM)
+		return AXIS_NONE;
+	return anchor_axis_rules[axis][alignment];
+}
+
+static_assert(get_axis_rule(noice::CENTER, noice::X) == AXIS_MIDDLE && get_axis_rule(noice::CENTER, noice::Y) == AXIS_MIDDLE);
+static_assert(get_axis_rule(noice::BOTTOM_RIGHT, noice::X) == AXIS_FAR && get_axis_rule(noice::TOP, noice::X) == AXIS_NONE);
+
 static float align_1d(noice::anchor alignment, float img_size, float ref_size, float ref_point, float scale, float norm_offset,
 		      noice::align_axis axis)
 {
 	float img_mid = img_size * 0.5f;
 	float ref_mid = ref_size * 0.5f;
 	float scaled_offset = img_size * norm_offset;
-	std::vector<noice::anchor> group1, group2, group3;
-
-	if (axis == noice::X) {
-		group1 = {noice::anchor::TOP_LEFT, noice::anchor::MIDDLE_LEFT, noice::anchor::BOTTOM_LEFT, noice::anchor::LEFT};
-		group2 = {noice::anchor::TOP_RIGHT, noice::anchor::MIDDLE_RIGHT, noice::anchor::BOTTOM_RIGHT, noice::anchor::RIGHT};
-		group3 = {noice::anchor::TOP_MIDDLE, noice::anchor::CENTER, noice::anchor::BOTTOM_MIDDLE, noice::anchor::MIDDLE_X};
-	} else if (axis == noice::Y) {
-		group1 = {noice::anchor::TOP_LEFT, noice::anchor::TOP_MIDDLE, noice::anchor::TOP_RIGHT, noice::anchor::TOP};
-		group2 = {noice::anchor::BOTTOM_LEFT, noice::anchor::BOTTOM_MIDDLE, noice::anchor::BOTTOM_RIGHT, noice::anchor::BOTTOM};
-		group3 = {noice::anchor::MIDDLE_LEFT, noice::anchor::CENTER, noice::anchor::MIDDLE_RIGHT, noice::anchor::MIDDLE_Y};
-	} else
-		throw std::invalid_argument("axis");
 
-	if (std::find(group1.begin(), group1.end(), alignment) != group1.end()) {
+	switch (get_axis_rule(alignment, axis)) {
+	case AXIS_NEAR:
 		return ref_point * scale + scaled_offset;
-	} else if (std::find(group2.begin(), group2.end(), alignment) != group2.end()) {
+	case AXIS_FAR: {
 		float dist_from_edge = (ref_size - ref_point) * scale;
 		return img_size - dist_from_edge - scaled_offset;
-	} else if (std::find(group3.begin(), group3.end(), alignment) != group3.end()) {
+	}
+	case AXIS_MIDDLE: {
 		float dist_from_mid = (ref_mid - ref_point) * scale;
 		float p = img_mid - dist_from_mid;
 
@@ -106,11 +139,13 @@ static float align_1d(noice::anchor alignment, float img_size, float ref_size, f
 		else if (p > img_mid && abs(p - scaled_offset - img_mid) < abs(p - img_mid))
 			p -= scaled_offset;
 		return p;
-	} else
+	}
+	default:
 		return ref_point;
+	}
 }
 
-void noice::region::align_box(struct obs_video_info ovi, float hud_scale)
+noice::region_rect noice::region::align_box(struct obs_video_info ovi, float hud_scale) const
 {
 	float img_w = (float)ovi.base_width, img_h = (float)ovi.base_height;
 	float refimg_w = (float)base->width, refimg_h = (float)base->height;
@@ -133,11 +168,13 @@ void noice::region::align_box(struct obs_video_info ovi, float hud_scale)
 	float _cx = align_1d(alignment, img_w, refimg_w, refbox_cx, scale, xoffset, noice::X);
 	float _cy = align_1d(alignment, img_h, refimg_h, refbox_cy, scale, yoffset, noice::Y);
 
+	region_rect box;
 	std::tie(box.x, box.y, box.w, box.h) = convert_box(std::make_tuple(_cx, _cy, _w, _h), noice::CXCYWH, noice::XYWH);
 #if VERBOSE_DEBUG
 	DLOG_INFO("region: game_state: %s region: %s x: %.3f y: %.3f w: %.3f h: %.3f", game_state.c_str(), region_name.c_str(), box.x,
 		  box.y, box.w, box.h);
 #endif
+	return box;
 }
 
 float noice::in_game_hud_scale::clamp_value()
@@ -150,6 +187,107 @@ float noice::in_game_hud_scale::clamp_value()
 	return ret;
 }
 
+int noice::in_game_hud_scale::step_index(float scale) const
+{
+	if (step <= 0.0f)
+		return -1;
+
+	float index = roundf(scale / step);
+	if (fabsf(index * step - scale) > 0.0001f || index < 0.0f || index > (float)INT_MAX)
+		return -1;
+	return (int)index;
+}
+
+noice::alignment_layout::alignment_layout(const std::vector<region> &regions)
+{
+	size_t count = regions.size();
+	for (auto *v : {&cx, &cy, &w, &h, &ref_w, &ref_h, &hud_weight, &kx_scaled, &kx_img, &kx_ref, &kx_raw, &ky_scaled, &ky_img,
+			&ky_ref, &ky_raw})
+		v->resize(count);
+
+	for (size_t i = 0; i < count; i++) {
+		const region &region = regions[i];
+
+		cx[i] = region.rect.x + region.rect.w * 0.5f;
+		cy[i] = region.rect.y + region.rect.h * 0.5f;
+		w[i] = region.rect.w;
+		h[i] = region.rect.h;
+		ref_w[i] = (float)region.base->width;
+		ref_h[i] = (float)region.base->height;
+		hud_weight[i] = region.hud_scale_locked ? 0.0f : 1.0f;
+
+		const axis_rule_coefficients &kx = axis_rule_table[get_axis_rule(region.alignment, noice::X)];
+		kx_scaled[i] = kx.scaled;
+		kx_img[i] = kx.img;
+		kx_ref[i] = kx.ref;
+		kx_raw[i] = kx.raw;
+
+		const axis_rule_coefficients &ky = axis_rule_table[get_axis_rule(region.alignment, noice::Y)];
+		ky_scaled[i] = ky.scaled;
+		ky_img[i] = ky.img;
+		ky_ref[i] = ky.ref;
+		ky_raw[i] = ky.raw;
+	}
+}
+
+void noice::alignment_layout::align(float img_w, float img_h, float hud_scale, region_rect *out) const
+{
+	// Kept free of branches and calls so the compiler can vectorize it
+	size_t count = size();
+	for (size_t i = 0; i < count; i++) {
+		float scale = fminf(img_w / ref_w[i], img_h / ref_h[i]);
+		scale *= 1.0f + hud_weight[i] * (hud_scale - 1.0f);
+
+		float box_w = w[i] * scale;
+		float box_h = h[i] * scale;
+		float box_cx = kx_scaled[i] * cx[i] * scale + kx_img[i] * img_w + kx_ref[i] * ref_w[i] * scale + kx_raw[i] * cx[i];
+		float box_cy = ky_scaled[i] * cy[i] * scale + ky_img[i] * img_h + ky_ref[i] * ref_h[i] * scale + ky_raw[i] * cy[i];
+
+		out[i].x = box_cx - box_w * 0.5f;
+		out[i].y = box_cy - box_h * 0.5f;
+		out[i].w = box_w;
+		out[i].h = box_h;
+	}
+}
+
+std::shared_ptr<const noice::aligned_boxes> noice::alignment_cache::get(const std::vector<region> &regions, uint32_t base_width,
+									uint32_t base_height, const in_game_hud_scale &hud, float hud_scale)
+{
+	std::unique_lock<std::mutex> lock(_lock);
+
+	if (!_layout || _layout->size() != regions.size())
+		_layout = std::make_shared<const alignment_layout>(regions);
+
+	int step = hud.step_index(hud_scale);
+	key_t key = std::make_tuple(base_width, base_height, step);
+	if (step >= 0) {
+		auto search = _boxes.find(key);
+		if (search != _boxes.end())
+			return search->second;
+	}
+
+	auto boxes = std::make_shared<aligned_boxes>(_layout->size());
+	_layout->align((float)base_width, (float)base_height, hud_scale, boxes->data());
+#if VERBOSE_DEBUG
+	DLOG_INFO("aligned %zu regions for %ux%u step: %d", boxes->size(), base_width, base_height, step);
+#endif
+
+	// Off-grid values come from hand edited settings, no point keeping them around
+	if (step >= 0) {
+		if (_boxes.size() >= ALIGNMENT_CACHE_MAX_ENTRIES)
+			_boxes.clear();
+		_boxes[key] = boxes;
+	}
+	return boxes;
+}
+
+void noice::alignment_cache::clear()
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	_layout = nullptr;
+	_boxes.clear();
+}
+
 noice::anchor_map::anchor_map()
 {
 	this->operator[]("top_left") = TOP_LEFT;
@@ -171,11 +309,25 @@ noice::anchor_map::anchor_map()
 
 noice::game::~game() {}
 
-noice::game::game() : current_resolution(nullptr), reset_regions(true), disabled(false) {}
+noice::game::game() : current_resolution(nullptr), disabled(false) {}
+
+std::shared_ptr<const noice::aligned_boxes> noice::game::align_regions(uint32_t base_width, uint32_t base_height, float hud_scale)
+{
+	auto regions_vec = regions();
+	if (!regions_vec)
+		return std::make_shared<const aligned_boxes>();
+	return _alignment.get(*regions_vec, base_width, base_height, in_game_hud, hud_scale);
+}
 
 noice::game_manager::~game_manager() {}
 
-noice::game_manager::game_manager() {}
+noice::game_manager::game_manager()
+	: _lazy(true),
+	  _cache_limit(DEFAULT_CACHE_LIMIT_KB * 1024),
+	  _cache_size(0),
+	  _cache_clock(0)
+{
+}
 
 std::vector<std::string> noice::game_manager::get_games()
 {
@@ -187,16 +339,40 @@ std::shared_ptr<noice::game> noice::game_manager::get_game(std::string name)
 {
 	std::unique_lock<std::mutex> lock(_lock);
 
-	auto search = _game_map.find(name);
-	if (search != _game_map.end()) {
-		return search->second;
-	}
-	return nullptr;
+	auto search = _game_index.find(name);
+	if (search == _game_index.end())
+		return nullptr;
+
+	game_catalog_entry &entry = search->second;
+	entry.last_used = ++_cache_clock;
+	if (entry.game != nullptr)
+		return entry.game;
+
+	std::shared_ptr<noice::game> game_entry = materialize_game(name, entry);
+	evict_games(name);
+	return game_entry;
+}
+
+std::string noice::game_manager::get_game_name_verbose(std::string name)
+{
+	std::unique_lock<std::mutex> lock(_lock);
+
+	auto search = _game_index.find(name);
+	if (search != _game_index.end())
+		return search->second.name_verbose;
+	return "";
 }
 
 bool noice::game_manager::is_game_acquired(std::string name, std::string instance)
 {
-	return is_game_acquired(get_game(name), instance);
+	{
+		// Avoid materializing games just to check their availability
+		std::unique_lock<std::mutex> lock(_lock);
+		auto search = _game_index.find(name);
+		if (search == _game_index.end() || search->second.disabled == true)
+			return false;
+	}
+	return is_name_acquired(name, instance);
 }
 
 bool noice::game_manager::is_game_acquired(std::shared_ptr<noice::game> game, std::string instance)
@@ -204,8 +380,16 @@ bool noice::game_manager::is_game_acquired(std::shared_ptr<noice::game> game, st
 	if (game == nullptr || game->disabled == true || game->name.empty())
 		return false;
 
+	return is_name_acquired(game->name, instance);
+}
+
+bool noice::game_manager::is_name_acquired(const std::string &name, const std::string &instance)
+{
+	if (name.empty())
+		return false;
+
 	std::unique_lock<std::mutex> lock(_lock_active);
-	auto search = _game_active.find(game->name);
+	auto search = _game_active.find(name);
 	if (search != _game_active.end()) {
 		if (!instance.empty() && search->second == instance) {
 			return false;
@@ -248,36 +432,241 @@ static void parse_resolution(std::string input, noice::video_resolution &res)
 	res.height = std::stoi(input.substr(x_index + 1, input.length()));
 }
 
-void noice::game_manager::refresh()
+#pragma mark Catalog scanning
+
+static size_t json_skip_ws(std::string_view text, size_t pos)
+{
+	while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n'))
+		pos++;
+	return pos;
+}
+
+static size_t json_skip_string(std::string_view text, size_t pos)
+{
+	// pos points at the opening quote
+	for (pos++; pos < text.size(); pos++) {
+		if (text[pos] == '\\')
+			pos++;
+		else if (text[pos] == '"')
+			return pos + 1;
+	}
+	return std::string_view::npos;
+}
+
+// Returns the position right after the value starting at pos, without building any
+// DOM nodes. Only the structure is tracked, full validation happens on materialization.
+static size_t json_skip_value(std::string_view text, size_t pos)
+{
+	if (pos >= text.size())
+		return std::string_view::npos;
+
+	if (text[pos] == '"')
+		return json_skip_string(text, pos);
+
+	if (text[pos] == '{' || text[pos] == '[') {
+		int depth = 0;
+		while (pos < text.size()) {
+			char c = text[pos];
+			if (c == '"') {
+				pos = json_skip_string(text, pos);
+				if (pos == std::string_view::npos)
+					return pos;
+				continue;
+			}
+			if (c == '{' || c == '[') {
+				depth++;
+			} else if (c == '}' || c == ']') {
+				if (--depth == 0)
+					return pos + 1;
+			}
+			pos++;
+		}
+		return std::string_view::npos;
+	}
+
+	while (pos < text.size() && text[pos] != ',' && text[pos] != '}' && text[pos] != ']' && text[pos] != ' ' &&
+	       text[pos] != '\t' && text[pos] != '\r' && text[pos] != '\n')
+		pos++;
+	return pos;
+}
+
+typedef std::function<void(const std::string &key, size_t offset, size_t length)> json_member_callback_t;
+
+// Enumerates the members of the object starting at pos with the byte range of each value
+static bool json_enum_members(std::string_view text, size_t pos, json_member_callback_t cb)
+{
+	pos = json_skip_ws(text, pos);
+	if (pos >= text.size() || text[pos] != '{')
+		return false;
+
+	pos = json_skip_ws(text, pos + 1);
+	if (pos < text.size() && text[pos] == '}')
+		return true;
+
+	while (pos < text.size()) {
+		if (text[pos] != '"')
+			return false;
+
+		size_t key_end = json_skip_string(text, pos);
+		if (key_end == std::string_view::npos)
+			return false;
+
+		std::string_view raw_key = text.substr(pos + 1, key_end - pos - 2);
+		std::string key;
+		if (raw_key.find('\\') == std::string_view::npos)
+			key = std::string(raw_key);
+		else
+			key = nlohmann::json::parse(text.substr(pos, key_end - pos)).get<std::string>();
+
+		pos = json_skip_ws(text, key_end);
+		if (pos >= text.size() || text[pos] != ':')
+			return false;
+
+		size_t value_begin = json_skip_ws(text, pos + 1);
+		size_t value_end = json_skip_value(text, value_begin);
+		if (value_end == std::string_view::npos)
+			return false;
+
+		cb(key, value_begin, value_end - value_begin);
+
+		pos = json_skip_ws(text, value_end);
+		if (pos < text.size() && text[pos] == ',') {
+			pos = json_skip_ws(text, pos + 1);
+			continue;
+		}
+		return pos < text.size() && text[pos] == '}';
+	}
+	return false;
+}
+
+static size_t estimate_game_footprint(const noice::game &game)
+{
+	size_t size = sizeof(noice::game) + game.name.capacity() + game.name_verbose.capacity();
+	for (const auto &it : game.map) {
+		size += sizeof(noice::video_resolution) + it.first->resolution.capacity();
+		size += it.second->capacity() * sizeof(noice::region);
+		for (const noice::region &region : *it.second)
+			size += region.game_state.capacity() + region.region_name.capacity();
+	}
+	return size;
+}
+
+static std::shared_ptr<noice::game> parse_game(const std::string &game, const nlohmann::json &game_obj, const std::string &name_suffix)
+{
+	auto resolutions_obj = game_obj["resolutions"];
+	if (!resolutions_obj.is_array()) {
+		DLOG_ERROR("JSON response is malformed, no resolution array");
+		return nullptr;
+	}
+
+	std::shared_ptr<noice::game> game_entry = std::make_shared<noice::game>();
+	game_entry->name = game;
+	game_entry->name_verbose = game_obj["name_verbose"].get<std::string>();
+	if (!name_suffix.empty())
+		game_entry->name_verbose += name_suffix;
+
+	noice::in_game_hud_scale &hud = game_entry->in_game_hud;
+	std::vector<float> hud_scale_range = game_obj["hud_scale"].get<std::vector<float>>();
+	hud.min = hud_scale_range.at(0);
+	hud.max = hud_scale_range.at(1);
+	hud.step = hud_scale_range.at(2);
+#if VERBOSE_DEBUG
+	DLOG_INFO("in_game_hud_scale: min: %f max: %f step: %f", hud.min, hud.max, hud.step);
+#endif
+
+	noice::anchor_map map_to_enum;
+
+	for (auto resolutions_it : resolutions_obj) {
+		std::string resolution_str = resolutions_it.get<std::string>();
+		std::shared_ptr<noice::video_resolution> res = std::make_shared<noice::video_resolution>();
+
+		if (game_entry->current_resolution.get() == nullptr)
+			game_entry->current_resolution = res;
+
+		parse_resolution(resolution_str, *res.get());
+#if VERBOSE_DEBUG
+		DLOG_INFO("resolution: %s width: %d height: %d", resolution_str.c_str(), res->width, res->height);
+#endif
+
+		auto regions = game_obj[resolution_str];
+		if (!regions.is_array()) {
+			DLOG_ERROR("JSON response is malformed, no regions array");
+			continue;
+		}
+
+		std::shared_ptr<std::vector<noice::region>> regions_vec = std::make_shared<std::vector<noice::region>>();
+		regions_vec->reserve(regions.size());
+
+		for (auto regions_it : regions) {
+			auto region_obj = regions_it.get<nlohmann::json::object_t>();
+			std::string game_state = region_obj["game_state"].get<std::string>();
+			std::string region_name = region_obj["region"].get<std::string>();
+			std::string alignment_str = region_obj["alignment"].get<std::string>();
+			noice::anchor alignment = map_to_enum[alignment_str];
+
+			bool hud_scale_locked = false;
+			if (region_obj.find("hud_scale_locked") != region_obj.end())
+				hud_scale_locked = region_obj["hud_scale_locked"].get<bool>();
+
+			noice::region_rect rect;
+			rect.x = region_obj["x"].get<float>();
+			rect.y = region_obj["y"].get<float>();
+			rect.w = region_obj["w"].get<float>();
+			rect.h = region_obj["h"].get<float>();
+
+			float min_overlap = 0.0f;
+			if (region_obj.find("min_overlap") != region_obj.end())
+				min_overlap = std::clamp(region_obj["min_overlap"].get<float>(), 0.0f, 1.0f);
+
+			noice::region region_entry(res, game_state, region_name, alignment, hud_scale_locked, rect, min_overlap);
+			regions_vec->push_back(region_entry);
+		}
+
+		game_entry->resolutions.push_back(res);
+		game_entry->map[res] = regions_vec;
+	}
+	return game_entry;
+}
+
+void noice::game_manager::configure(bool lazy, size_t cache_limit, const std::string &name_suffix)
 {
 	std::unique_lock<std::mutex> lock(_lock);
-	const char *conf = noice::deployment_config_path("regions.json");
-	std::ifstream regions_json(conf, std::ios::in);
-	refresh_main(regions_json);
-	regions_json.close();
-	bfree((void *)conf);
+	_lazy = lazy;
+	_cache_limit = cache_limit;
+	_name_suffix = name_suffix;
 }
 
 bool noice::game_manager::refresh_main(std::istream &input)
 {
+	NOICE_PROFILE_SCOPE(refresh_main);
+	std::unique_lock<std::mutex> lock(_lock);
 	try {
-		nlohmann::json data;
-		data = nlohmann::json::parse(input);
+		std::string catalog((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+		std::string_view text(catalog);
+
+		std::map<std::string, std::pair<size_t, size_t>> members;
+		bool valid = json_enum_members(text, 0, [&members](const std::string &key, size_t offset, size_t length) {
+			members[key] = std::make_pair(offset, length);
+		});
+		if (!valid) {
+			DLOG_ERROR("JSON response is malformed");
+			return false;
+		}
 
-		nlohmann::json games_arr = data["games"];
+		auto games_member = members.find("games");
+		nlohmann::json games_arr;
+		if (games_member != members.end())
+			games_arr = nlohmann::json::parse(text.substr(games_member->second.first, games_member->second.second));
 		if (!games_arr.is_array()) {
 			DLOG_ERROR("JSON response is malformed, no games listed");
 			return false;
 		}
 
+		_catalog = std::move(catalog);
+		text = std::string_view(_catalog);
 		_games.clear();
-		_game_map.clear();
-
-		std::string name_suffix = "";
-		auto cfg = noice::configuration::instance();
-		// TODO: Could use cfg->noice_service_selected() to hilight when service is inactive though source labels, but..
-		if (!noice::is_production())
-			name_suffix = noice::string_format(" (%s)", cfg->deployment().c_str());
+		_game_index.clear();
+		_cache_size = 0;
 
 		// Ensure a placeholder game always exists to make life easier
 		{
@@ -296,11 +685,12 @@ bool noice::game_manager::refresh_main(std::istream &input)
 			game_entry->resolutions.push_back(res);
 			game_entry->map[res] = regions_vec;
 
-			_game_map[game_entry->name] = game_entry;
+			game_catalog_entry &entry = _game_index[game_entry->name];
+			entry.name_verbose = game_entry->name_verbose;
+			entry.disabled = true;
+			entry.game = game_entry;
 		}
 
-		anchor_map map_to_enum;
-
 		for (auto games_it : games_arr) {
 			std::string game = games_it.get<std::string>();
 #if VERBOSE_DEBUG
@@ -308,77 +698,33 @@ bool noice::game_manager::refresh_main(std::istream &input)
 #endif
 			_games.push_back(game);
 
-			auto game_obj = data[game];
-			if (!game_obj.is_object()) {
+			auto game_member = members.find(game);
+			if (game_member == members.end() || text[game_member->second.first] != '{') {
 				DLOG_ERROR("JSON response is malformed, no game object");
 				continue;
 			}
-			auto resolutions_obj = game_obj["resolutions"];
-			if (!resolutions_obj.is_array()) {
-				DLOG_ERROR("JSON response is malformed, no resolution array");
-				continue;
-			}
 
-			std::shared_ptr<noice::game> game_entry = std::make_shared<noice::game>();
-			game_entry->name = game;
-			game_entry->name_verbose = game_obj["name_verbose"].get<std::string>();
-			if (!name_suffix.empty())
-				game_entry->name_verbose += name_suffix;
-
-			noice::in_game_hud_scale &hud = game_entry->in_game_hud;
-			std::vector<float> hud_scale_range = game_obj["hud_scale"].get<std::vector<float>>();
-			hud.min = hud_scale_range.at(0);
-			hud.max = hud_scale_range.at(1);
-			hud.step = hud_scale_range.at(2);
-#if VERBOSE_DEBUG
-			DLOG_INFO("in_game_hud_scale: min: %f max: %f step: %f", hud.min, hud.max, hud.step);
-#endif
+			game_catalog_entry entry;
+			entry.offset = game_member->second.first;
+			entry.length = game_member->second.second;
 
-			for (auto resolutions_it : resolutions_obj) {
-				std::string resolution_str = resolutions_it.get<std::string>();
-				std::shared_ptr<video_resolution> res = std::make_shared<video_resolution>();
+			// Only the label is needed up front, for the game selection list
+			json_enum_members(text.substr(entry.offset, entry.length), 0,
+					  [&entry, &text](const std::string &key, size_t offset, size_t length) {
+						  if (key == "name_verbose")
+							  entry.name_verbose = nlohmann::json::parse(text.substr(entry.offset + offset, length))
+										       .get<std::string>();
+					  });
+			entry.name_verbose += _name_suffix;
 
-				if (game_entry->current_resolution.get() == nullptr)
-					game_entry->current_resolution = res;
-
-				parse_resolution(resolution_str, *res.get());
-#if VERBOSE_DEBUG
-				DLOG_INFO("resolution: %s width: %d height: %d", resolution_str.c_str(), res->width, res->height);
-#endif
+			_game_index[game] = entry;
+		}
 
-				auto regions = game_obj[resolution_str];
-				if (!regions.is_array()) {
-					DLOG_ERROR("JSON response is malformed, no regions array");
-					continue;
-				}
-
-				std::shared_ptr<std::vector<noice::region>> regions_vec = std::make_shared<std::vector<noice::region>>();
-
-				for (auto regions_it : regions) {
-					auto region_obj = regions_it.get<nlohmann::json::object_t>();
-					std::string game_state = region_obj["game_state"].get<std::string>();
-					std::string region_name = region_obj["region"].get<std::string>();
-					std::string alignment_str = region_obj["alignment"].get<std::string>();
-					anchor alignment = map_to_enum[alignment_str];
-
-					bool hud_scale_locked = false;
-					if (region_obj.find("hud_scale_locked") != region_obj.end())
-						hud_scale_locked = region_obj["hud_scale_locked"].get<bool>();
-
-					region_rect rect;
-					rect.x = region_obj["x"].get<float>();
-					rect.y = region_obj["y"].get<float>();
-					rect.w = region_obj["w"].get<float>();
-					rect.h = region_obj["h"].get<float>();
-
-					noice::region region_entry(res, game_state, region_name, alignment, hud_scale_locked, rect);
-					regions_vec->push_back(region_entry);
-				}
-
-				game_entry->resolutions.push_back(res);
-				game_entry->map[res] = regions_vec;
+		if (!_lazy) {
+			for (auto &it : _game_index) {
+				if (it.second.game == nullptr)
+					materialize_game(it.first, it.second);
 			}
-			_game_map[game] = game_entry;
 		}
 	} catch (std::exception const &ex) {
 		DLOG_ERROR("JSON parse error: %s", ex.what());
@@ -387,6 +733,60 @@ bool noice::game_manager::refresh_main(std::istream &input)
 	return true;
 }
 
+std::shared_ptr<noice::game> noice::game_manager::materialize_game(const std::string &name, game_catalog_entry &entry)
+{
+	try {
+		std::string_view text(_catalog);
+		nlohmann::json game_obj = nlohmann::json::parse(text.substr(entry.offset, entry.length));
+		if (!game_obj.is_object()) {
+			DLOG_ERROR("JSON response is malformed, no game object");
+			return nullptr;
+		}
+
+		entry.game = parse_game(name, game_obj, _name_suffix);
+	} catch (std::exception const &ex) {
+		DLOG_ERROR("JSON parse error: %s", ex.what());
+		entry.game = nullptr;
+	}
+
+	if (entry.game == nullptr)
+		return nullptr;
+
+	entry.footprint = estimate_game_footprint(*entry.game);
+	_cache_size += entry.footprint;
+#if VERBOSE_DEBUG
+	DLOG_INFO("materialized game: %s (%zu bytes, cache: %zu bytes)", name.c_str(), entry.footprint, _cache_size);
+#endif
+	return entry.game;
+}
+
+void noice::game_manager::evict_games(const std::string &keep)
+{
+	if (!_lazy)
+		return;
+
+	while (_cache_size > _cache_limit) {
+		game_catalog_entry *candidate = nullptr;
+
+		for (auto &it : _game_index) {
+			game_catalog_entry &entry = it.second;
+
+			// Games in use elsewhere hold another reference and can't be evicted
+			if (entry.game == nullptr || entry.disabled || it.first == keep || entry.game.use_count() > 1)
+				continue;
+			if (candidate == nullptr || entry.last_used < candidate->last_used)
+				candidate = &entry;
+		}
+
+		if (candidate == nullptr)
+			break;
+
+		_cache_size -= candidate->footprint;
+		candidate->footprint = 0;
+		candidate->game = nullptr;
+	}
+}
+
 std::shared_ptr<noice::game_manager> noice::game_manager::_instance = nullptr;
 
 void noice::game_manager::initialize()
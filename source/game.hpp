@@ -22,6 +22,7 @@
 #include <map>
 #include <mutex>
 #include <istream>
+#include <tuple>
 #include <obs.h>
 
 #define NOICE_PLACEHOLDER_GAME_NAME "no_game_selected"
@@ -32,6 +33,8 @@ enum box_format { XYXY = 0, XYWH = 1, CXCYWH = 2 };
 
 typedef std::tuple<float, float, float, float> box_tuple;
 
+box_tuple convert_box(box_tuple box, box_format in_fmt, box_format out_fmt);
+
 enum anchor {
 	TOP_LEFT = 0,
 	TOP_MIDDLE = 1,
@@ -86,14 +89,14 @@ public:
 	~region(){};
 
 	region(std::shared_ptr<video_resolution> base, std::string state, std::string name, anchor alignment, bool hud_scale_locked,
-	       region_rect rect)
+	       region_rect rect, float min_overlap = 0.0f)
 		: base(base),
 		  game_state(state),
 		  region_name(name),
 		  alignment(alignment),
 		  hud_scale_locked(hud_scale_locked),
 		  rect(rect),
-		  hits(0)
+		  min_overlap(min_overlap)
 	{
 	}
 
@@ -103,11 +106,10 @@ public:
 	anchor alignment;
 	bool hud_scale_locked;
 	region_rect rect;
-	int hits;
-
-	region_rect box;
+	// Fraction of the region area an item has to cover before it counts as a hit
+	float min_overlap;
 
-	void align_box(struct obs_video_info ovi, float hud_scale);
+	region_rect align_box(struct obs_video_info ovi, float hud_scale) const;
 };
 
 struct in_game_hud_scale {
@@ -118,6 +120,42 @@ struct in_game_hud_scale {
 	in_game_hud_scale() : min(1.0f), max(1.0f), step(0.25f), value(1.0) {}
 
 	float clamp_value();
+
+	// Index of the slider step matching value, or -1 when value is off the step grid
+	int step_index(float value) const;
+};
+
+// Structure-of-arrays copy of a region list with the anchor rules already resolved
+// to per-axis coefficients, so aligning a whole game runs as one branchless loop.
+struct alignment_layout {
+	std::vector<float> cx, cy, w, h;
+	std::vector<float> ref_w, ref_h;
+	std::vector<float> hud_weight;
+	std::vector<float> kx_scaled, kx_img, kx_ref, kx_raw;
+	std::vector<float> ky_scaled, ky_img, ky_ref, ky_raw;
+
+	alignment_layout(const std::vector<region> &regions);
+
+	size_t size() const { return cx.size(); }
+
+	void align(float img_w, float img_h, float hud_scale, region_rect *out) const;
+};
+
+typedef std::vector<region_rect> aligned_boxes;
+
+// Memoizes aligned boxes per (base canvas size, HUD scale step). Results are immutable
+// and shared, so callers may hold on to them while the cache is modified.
+class alignment_cache {
+	typedef std::tuple<uint32_t, uint32_t, int> key_t;
+
+	std::mutex _lock;
+	std::shared_ptr<const alignment_layout> _layout;
+	std::map<key_t, std::shared_ptr<const aligned_boxes>> _boxes;
+
+public:
+	std::shared_ptr<const aligned_boxes> get(const std::vector<region> &regions, uint32_t base_width, uint32_t base_height,
+						 const in_game_hud_scale &hud, float hud_scale);
+	void clear();
 };
 
 // Taken and modified from https://gist.github.com/yoggy/8999625
@@ -242,36 +280,90 @@ public:
 
 	std::shared_ptr<video_resolution> current_resolution;
 
-	bool reset_regions;
 	bool disabled;
 
-	std::shared_ptr<std::vector<noice::region>> regions() { return map[current_resolution]; }
+	std::shared_ptr<std::vector<noice::region>> regions()
+	{
+		auto search = map.find(current_resolution);
+		return search != map.end() ? search->second : nullptr;
+	}
+
+	std::shared_ptr<const aligned_boxes> align_regions(uint32_t base_width, uint32_t base_height, float hud_scale);
+
+private:
+	alignment_cache _alignment;
+};
+
+// Regions of a game aligned for a specific canvas. Immutable once built, the game
+// reference keeps the region definitions alive for as long as the result is used.
+struct aligned_regions {
+	std::shared_ptr<noice::game> game;
+	std::shared_ptr<const std::vector<region>> regions;
+	std::shared_ptr<const aligned_boxes> boxes;
+	uint32_t base_width;
+	uint32_t base_height;
+	float hud_scale;
+
+	aligned_regions() : game(nullptr), regions(nullptr), boxes(nullptr), base_width(0), base_height(0), hud_scale(1.0f) {}
+};
+
+// Location of a single game object within the raw regions.json text. Regions are
+// only materialized from the referenced slice when the game is first requested.
+struct game_catalog_entry {
+	std::string name_verbose;
+	size_t offset;
+	size_t length;
+	bool disabled;
+
+	std::shared_ptr<noice::game> game;
+	size_t footprint;
+	uint64_t last_used;
+
+	game_catalog_entry() : offset(0), length(0), disabled(false), game(nullptr), footprint(0), last_used(0) {}
 };
 
 class game_manager {
 	std::mutex _lock;
 	std::mutex _lock_active;
 	std::vector<std::string> _games;
-	std::map<std::string, std::shared_ptr<noice::game>> _game_map;
+	std::map<std::string, game_catalog_entry> _game_index;
 	std::map<std::string, std::string> _game_active;
 
+	std::string _catalog;
+	std::string _name_suffix;
+	bool _lazy;
+	size_t _cache_limit;
+	size_t _cache_size;
+	uint64_t _cache_clock;
+
 public:
+	static constexpr size_t DEFAULT_CACHE_LIMIT_KB = 1024;
+
 	virtual ~game_manager();
 	game_manager();
 
 	std::vector<std::string> get_games();
 	std::shared_ptr<noice::game> get_game(std::string name);
+	std::string get_game_name_verbose(std::string name);
 
 	bool is_game_acquired(std::string name, std::string instance);
 	bool is_game_acquired(std::shared_ptr<noice::game> game, std::string instance);
 	void acquire_game(std::shared_ptr<noice::game> game, std::string instance);
 	void release_game(std::shared_ptr<noice::game> game, std::string instance);
 
-	void refresh();
+	// Takes effect on the next refresh, the suffix is appended to every game label
+	void configure(bool lazy, size_t cache_limit, const std::string &name_suffix);
 
-private:
+	// Replaces the catalog with the regions.json read from input, kept as is on errors
 	bool refresh_main(std::istream &input);
 
+private:
+	bool is_name_acquired(const std::string &name, const std::string &instance);
+
+	std::shared_ptr<noice::game> materialize_game(const std::string &name, game_catalog_entry &entry);
+
+	void evict_games(const std::string &keep);
+
 	// Singleton
 private:
 	static std::shared_ptr<noice::game_manager> _instance;
@@ -14,12 +14,35 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "noice-bridge.hpp"
+#include "util/util-trace.hpp"
 #include <obs-module.h>
 #include <util/platform.h>
+#include <cstdio>
+#include <sstream>
 #include <stdexcept>
 
 #if NOICE_CORE
 
+// Paths come from Qt as UTF-8, which std::ofstream would take as the ANSI code page on Windows
+static bool write_file(const std::string &path, const std::string &content, const char *what)
+{
+	FILE *file = os_fopen(path.c_str(), "wb");
+	if (!file) {
+		DLOG_ERROR("Failed to open '%s' for writing the %s", path.c_str(), what);
+		return false;
+	}
+
+	bool written = fwrite(content.data(), 1, content.size(), file) == content.size();
+	if (fclose(file) != 0)
+		written = false;
+	if (!written) {
+		DLOG_ERROR("Failed to write the %s to '%s'", what, path.c_str());
+		os_unlink(path.c_str());
+		return false;
+	}
+	return true;
+}
+
 noice::bridge::~bridge() {}
 
 noice::bridge::bridge() {}
@@ -54,6 +77,53 @@ std::string_view noice::bridge::get_unique_identifier()
 	return noice::get_unique_identifier();
 }
 
+void noice::bridge::set_tracing(bool enabled)
+{
+	if (enabled == noice::util::trace::enabled())
+		return;
+
+	if (enabled) {
+		noice::util::trace::start();
+	} else {
+		noice::util::trace::stop();
+	}
+	DLOG_INFO("Tracing %s", enabled ? "started" : "stopped");
+}
+
+bool noice::bridge::tracing()
+{
+	return noice::util::trace::enabled();
+}
+
+bool noice::bridge::save_trace(const std::string &path)
+{
+	std::ostringstream json;
+	noice::util::trace::write_json(json);
+	if (!write_file(path, json.str(), "trace"))
+		return false;
+
+	DLOG_INFO("Trace saved to '%s'", path.c_str());
+	return true;
+}
+
+bool noice::bridge::save_scene_recording(const std::string &path)
+{
+	auto st = noice::source::scene_tracker::instance();
+	noice::validation::scene_recording recording;
+	if (!st || !st->record_scene(recording) || recording.frames.empty()) {
+		DLOG_ERROR("No scene to record");
+		return false;
+	}
+
+	std::ostringstream data(std::ios::out | std::ios::binary);
+	if (!noice::validation::write_recording(data, recording) || !write_file(path, data.str(), "scene recording"))
+		return false;
+
+	DLOG_INFO("Scene with %zu items and %zu regions recorded to '%s'", recording.frames.back().items.size(), recording.regions.size(),
+		  path.c_str());
+	return true;
+}
+
 std::shared_ptr<noice::bridge> noice::bridge::_instance = nullptr;
 
 void noice::bridge::initialize()
@@ -35,6 +35,14 @@ public:
 	virtual std::string get_web_endpoint(std::string_view const args = "");
 	virtual std::string_view get_unique_identifier();
 
+	virtual void set_tracing(bool enabled);
+	virtual bool tracing();
+	// Chrome trace-event JSON of everything recorded since tracing started, path in UTF-8
+	virtual bool save_trace(const std::string &path);
+
+	// Current scene layout and canvas for offline replay, see scene-recording.hpp. Path in UTF-8.
+	virtual bool save_scene_recording(const std::string &path);
+
 	// Singleton
 private:
 	static std::shared_ptr<noice::bridge> _instance;
@@ -15,11 +15,15 @@
 
 #include "noice-validator.hpp"
 #include "scene-tracker.hpp"
+#include "scene-view.hpp"
+#include "validator-registry.hpp"
 #include "game.hpp"
+#include "util/util-profiler.hpp"
+#include "util/util-trace.hpp"
 #include <algorithm>
 #include <obs-module.h>
 
-#define DLOG_CTX_(x, level, format, ...) blog(level, DLOG_PREFIX " [%p] id: %d %s: " format, x->_source, x->_id, __FUNCTION__, __VA_ARGS__)
+#define DLOG_CTX_(x, level, format, ...) NOICE_LOG(level, DLOG_PREFIX " [%p] id: %d %s: " format, x->_source, x->_id, __FUNCTION__, __VA_ARGS__)
 #define DLOG_CTX_ERROR(x, format, ...) DLOG_CTX_(x, LOG_ERROR, format, __VA_ARGS__)
 #define DLOG_CTX_WARNING(x, format, ...) DLOG_CTX_(x, LOG_WARNING, format, __VA_ARGS__)
 #define DLOG_CTX_INFO(x, format, ...) DLOG_CTX_(x, LOG_INFO, format, __VA_ARGS__)
@@ -117,283 +121,17 @@ static void DrawRect(float thickness, vec2 scale)
 	gs_vertexbuffer_destroy(rect);
 }
 
-static bool CloseFloat(float a, float b, float epsilon = 0.01)
-{
-	using std::abs;
-	return abs(a - b) <= epsilon;
-}
-
-static bool CounterClockwise(float x1, float x2, float x3, float y1, float y2, float y3)
-{
-	return (y3 - y1) * (x2 - x1) > (y2 - y1) * (x3 - x1);
-}
-
-static bool IntersectLine(float x1, float x2, float x3, float x4, float y1, float y2, float y3, float y4)
-{
-	bool a = CounterClockwise(x1, x2, x3, y1, y2, y3);
-	bool b = CounterClockwise(x1, x2, x4, y1, y2, y4);
-	bool c = CounterClockwise(x3, x4, x1, y3, y4, y1);
-	bool d = CounterClockwise(x3, x4, x2, y3, y4, y2);
-
-	return (a != b) && (c != d);
-}
-
-static bool IntersectBox(matrix4 transform, float x1, float x2, float y1, float y2)
-{
-	float x3, x4, y3, y4;
-
-	x3 = transform.t.x;
-	y3 = transform.t.y;
-	x4 = x3 + transform.x.x;
-	y4 = y3 + transform.x.y;
-
-	if (IntersectLine(x1, x1, x3, x4, y1, y2, y3, y4) || IntersectLine(x1, x2, x3, x4, y1, y1, y3, y4) ||
-	    IntersectLine(x2, x2, x3, x4, y1, y2, y3, y4) || IntersectLine(x1, x2, x3, x4, y2, y2, y3, y4))
-		return true;
-
-	x4 = x3 + transform.y.x;
-	y4 = y3 + transform.y.y;
-
-	if (IntersectLine(x1, x1, x3, x4, y1, y2, y3, y4) || IntersectLine(x1, x2, x3, x4, y1, y1, y3, y4) ||
-	    IntersectLine(x2, x2, x3, x4, y1, y2, y3, y4) || IntersectLine(x1, x2, x3, x4, y2, y2, y3, y4))
-		return true;
-
-	x3 = transform.t.x + transform.x.x;
-	y3 = transform.t.y + transform.x.y;
-	x4 = x3 + transform.y.x;
-	y4 = y3 + transform.y.y;
-
-	if (IntersectLine(x1, x1, x3, x4, y1, y2, y3, y4) || IntersectLine(x1, x2, x3, x4, y1, y1, y3, y4) ||
-	    IntersectLine(x2, x2, x3, x4, y1, y2, y3, y4) || IntersectLine(x1, x2, x3, x4, y2, y2, y3, y4))
-		return true;
-
-	x3 = transform.t.x + transform.y.x;
-	y3 = transform.t.y + transform.y.y;
-	x4 = x3 + transform.x.x;
-	y4 = y3 + transform.x.y;
-
-	if (IntersectLine(x1, x1, x3, x4, y1, y2, y3, y4) || IntersectLine(x1, x2, x3, x4, y1, y1, y3, y4) ||
-	    IntersectLine(x2, x2, x3, x4, y1, y2, y3, y4) || IntersectLine(x1, x2, x3, x4, y2, y2, y3, y4))
-		return true;
-
-	return false;
-}
-
-static bool FindItemsInBox(obs_sceneitem_t *item, vec2 startPos, vec2 pos, struct matrix4 *parent_transform = nullptr)
-{
-	matrix4 transform;
-	matrix4 invTransform;
-	vec3 transformedPos;
-	vec3 pos3;
-	vec3 pos3_;
-
-	vec2 pos_min, pos_max;
-	vec2_min(&pos_min, &startPos, &pos);
-	vec2_max(&pos_max, &startPos, &pos);
-
-	const float x1 = pos_min.x;
-	const float x2 = pos_max.x;
-	const float y1 = pos_min.y;
-	const float y2 = pos_max.y;
-
-	vec3_set(&pos3, pos.x, pos.y, 0.0f);
-	obs_sceneitem_get_box_transform(item, &transform);
-
-	if (parent_transform)
-		matrix4_mul(&transform, &transform, parent_transform);
-
-	matrix4_inv(&invTransform, &transform);
-	vec3_transform(&transformedPos, &pos3, &invTransform);
-	vec3_transform(&pos3_, &transformedPos, &transform);
-
-	if (CloseFloat(pos3.x, pos3_.x) && CloseFloat(pos3.y, pos3_.y) && transformedPos.x >= 0.0f && transformedPos.x <= 1.0f &&
-	    transformedPos.y >= 0.0f && transformedPos.y <= 1.0f) {
-		return true;
-	}
-
-	if (transform.t.x > x1 && transform.t.x < x2 && transform.t.y > y1 && transform.t.y < y2) {
-		return true;
-	}
-
-	if (transform.t.x + transform.x.x > x1 && transform.t.x + transform.x.x < x2 && transform.t.y + transform.x.y > y1 &&
-	    transform.t.y + transform.x.y < y2) {
-		return true;
-	}
-
-	if (transform.t.x + transform.y.x > x1 && transform.t.x + transform.y.x < x2 && transform.t.y + transform.y.y > y1 &&
-	    transform.t.y + transform.y.y < y2) {
-		return true;
-	}
-
-	if (transform.t.x + transform.x.x + transform.y.x > x1 && transform.t.x + transform.x.x + transform.y.x < x2 &&
-	    transform.t.y + transform.x.y + transform.y.y > y1 && transform.t.y + transform.x.y + transform.y.y < y2) {
-		return true;
-	}
-
-	if (transform.t.x + 0.5 * (transform.x.x + transform.y.x) > x1 && transform.t.x + 0.5 * (transform.x.x + transform.y.x) < x2 &&
-	    transform.t.y + 0.5 * (transform.x.y + transform.y.y) > y1 && transform.t.y + 0.5 * (transform.x.y + transform.y.y) < y2) {
-		return true;
-	}
-
-	if (IntersectBox(transform, x1, x2, y1, y2)) {
-		return true;
-	}
-
-	return false;
-}
-
-static bool SceneItemHasVideo(obs_sceneitem_t *item)
-{
-	obs_source_t *source = obs_sceneitem_get_source(item);
-	uint32_t flags = obs_source_get_output_flags(source);
-	return (flags & OBS_SOURCE_VIDEO) != 0;
-}
-
-static vec2 GetItemSize(obs_sceneitem_t *item)
-{
-	obs_bounds_type boundsType = obs_sceneitem_get_bounds_type(item);
-	vec2 size;
-
-	if (boundsType != OBS_BOUNDS_NONE) {
-		obs_sceneitem_get_bounds(item, &size);
-	} else {
-		obs_source_t *source = obs_sceneitem_get_source(item);
-		obs_sceneitem_crop crop;
-		vec2 scale;
-
-		obs_sceneitem_get_scale(item, &scale);
-		obs_sceneitem_get_crop(item, &crop);
-		size.x = float(obs_source_get_width(source) - crop.left - crop.right) * scale.x;
-		size.y = float(obs_source_get_height(source) - crop.top - crop.bottom) * scale.y;
-	}
-
-	return size;
-}
-
 #pragma mark Utilities
 
-static void GetItemSizeRotated(vec2 &pos, vec2 &size, float rot)
-{
-	float ang = rot * (M_PI / 180.0f);
-
-	float sinA = sin(ang);
-	float cosA = cos(ang);
-
-	float sinAA = fabs(sinA);
-	float cosAA = fabs(cosA);
-
-	float bbH = size.x * sinAA + size.y * cosAA;
-	float bbW = size.x * cosAA + size.y * sinAA;
-
-	float cx = pos.x + size.x / 2 * cosA - size.y / 2 * sinA;
-	float cy = pos.y + size.x / 2 * sinA + size.y / 2 * cosA;
-
-	float bbX = cx - bbW / 2;
-	float bbY = cy - bbH / 2;
-
-	vec2_set(&pos, bbX, bbY);
-	vec2_set(&size, bbW, bbH);
-}
-
-bool noice::source::validator_instance::sceneitem_has_canvas_coverage(obs_sceneitem_t *item, int coverage_requirement)
-{
-	obs_source_t *source = obs_sceneitem_get_source(item);
-	std::string id = obs_source_get_unversioned_id(source);
-
-	// Base canvas size
-	vec2 cpos;
-	vec2_set(&cpos, 0.0f, 0.0f);
-	vec2 csize;
-	vec2_set(&csize, (float)_ovi.base_width, (float)_ovi.base_height);
-
-	vec2 pos;
-	obs_sceneitem_get_pos(item, &pos);
-	vec2 size = GetItemSize(item);
-
-	float rot = obs_sceneitem_get_rot(item);
-	if (rot != 0.0f)
-		GetItemSizeRotated(pos, size, rot);
-
-	// Flipped
-	if (size.x < 0) {
-		size.x = abs(size.x);
-		pos.x -= size.x;
-	}
-	if (size.y < 0) {
-		size.y = abs(size.y);
-		pos.y -= size.y;
-	}
-
-	// Clamp outside canvas
-	if (pos.x < 0.0f) {
-		size.x += pos.x;
-		pos.x = 0.0f;
-	}
-	if (pos.y < 0.0f) {
-		size.y += pos.y;
-		pos.y = 0.0f;
-	}
-	if (size.x > csize.x)
-		size.x = csize.x;
-	if (size.y > csize.y)
-		size.y = csize.y;
-
-	float dist_x = (fminf(size.x, csize.x) - fmaxf(size.x + pos.x, csize.x + cpos.x)) + csize.x;
-	float dist_y = (fminf(size.y, csize.y) - fmaxf(size.y + pos.y, csize.y + cpos.y)) + csize.y;
-	int coverage = (int)((dist_x * dist_y) / (csize.x * csize.y) * 100.0f);
-
-#if 0
-	DLOG_CTX_INFO(this, "%s pos: %d/%d item: %dx%d <> %dx%d dist: %dx%d coverage: %d%%", id.c_str(),
-		(int)pos.x, (int)pos.y,
-		(int)size.x, (int)size.y,
-		(int)csize.x, (int)csize.y,
-		(int)dist_x, (int)dist_y,
-		coverage);
-#endif
-
-	if (coverage > coverage_requirement)
-		return true;
-
-	return false;
-}
-
-bool noice::source::validator_instance::sceneitem_is_main_video_source(obs_sceneitem_t *item)
+void noice::source::validator_instance::region_draw(const noice::validation::rect &box, int region_hits)
 {
-	obs_source_t *source = obs_sceneitem_get_source(item);
-	std::string id = obs_source_get_unversioned_id(source);
-
-#if 0
-	DLOG_CTX_INFO(this, "%s", id.c_str());
-#endif
-	auto &map = *(_main_video_sources.get());
-	if (map.find(id) != map.end())
-		return true;
-	return false;
-}
-
-void noice::source::validator_instance::region_validate(noice::region &region, obs_sceneitem_t *item, int &hits)
-{
-	vec2 startPos;
-	vec2 pos;
-	vec2_set(&startPos, region.box.x, region.box.y);
-	vec2_set(&pos, region.box.x + region.box.w, region.box.y + region.box.h);
-
-	bool hit = FindItemsInBox(item, startPos, pos, &_parent_transform);
-	if (hit) {
-		hits++;
-		region.hits++;
-	}
-}
-
-void noice::source::validator_instance::region_draw(noice::region &region)
-{
-	if (_draw_all_regions == false && region.hits == 0)
+	if (_draw_all_regions == false && region_hits == 0)
 		return;
 
 	matrix4 boxTransform;
 	matrix4_identity(&boxTransform);
-	matrix4_scale3f(&boxTransform, &boxTransform, region.box.w, region.box.h, 1.0f);
-	matrix4_translate3f(&boxTransform, &boxTransform, region.box.x, region.box.y, 0.0f);
+	matrix4_scale3f(&boxTransform, &boxTransform, box.w, box.h, 1.0f);
+	matrix4_translate3f(&boxTransform, &boxTransform, box.x, box.y, 0.0f);
 
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_DEFAULT, "region_draw");
 
@@ -401,8 +139,8 @@ void noice::source::validator_instance::region_draw(noice::region &region)
 	vec2 boxScale;
 
 	gs_matrix_get(&curTransform);
-	boxScale.x = region.box.w;
-	boxScale.y = region.box.h;
+	boxScale.x = box.w;
+	boxScale.y = box.h;
 
 	boxScale.x *= curTransform.x.x;
 	boxScale.y *= curTransform.y.y;
@@ -418,77 +156,38 @@ void noice::source::validator_instance::region_draw(noice::region &region)
 
 	gs_matrix_pop();
 	GS_DEBUG_MARKER_END();
-
-	region.hits = 0;
 }
 
-void noice::source::validator_instance::source_draw(obs_sceneitem_t *item, bool collect_hit_source_names)
+static void from_transform(matrix4 &out, const noice::validation::transform &m)
 {
-	if (!obs_sceneitem_visible(item))
-		return;
-
-	if (obs_sceneitem_is_group(item)) {
-		matrix4 mat;
-		obs_sceneitem_get_draw_transform(item, &mat);
-
-		gs_matrix_push();
-		gs_matrix_mul(&mat);
-
-		matrix4_copy(&_parent_transform, &mat);
-
-		auto source_draw_item = [this, collect_hit_source_names](obs_sceneitem_t *item) {
-			source_draw(item, collect_hit_source_names);
-		};
-		using source_draw_item_t = decltype(source_draw_item);
-
-		obs_sceneitem_group_enum_items(
-			item,
-			[](obs_scene_t *, obs_sceneitem_t *item, void *param) {
-				source_draw_item_t *func;
-				func = reinterpret_cast<source_draw_item_t *>(param);
-				(*func)(item);
-				return true;
-			},
-			&source_draw_item);
-
-		matrix4_identity(&_parent_transform);
-		gs_matrix_pop();
-
-		// Do not validate/hilight the group itself, because the grouped items could be miles apart
-		return;
-	}
-
-	if (!SceneItemHasVideo(item))
-		return;
-	if (sceneitem_is_main_video_source(item))
-		return;
-	if (sceneitem_has_canvas_coverage(item, 98))
-		return;
-
-	int hits = 0;
-	for (noice::region &region : *_game->regions()) {
-		region_validate(region, item, hits);
-	}
-
-	if (_debug_sources == false && hits == 0)
-		return;
+	matrix4_identity(&out);
+	out.x.x = m.x.x;
+	out.x.y = m.x.y;
+	out.y.x = m.y.x;
+	out.y.y = m.y.y;
+	out.t.x = m.t.x;
+	out.t.y = m.t.y;
+}
 
-	if (collect_hit_source_names) {
-		obs_source_t *item_source = obs_sceneitem_get_source(item);
-		const char *src_name = obs_source_get_name(item_source);
+void noice::source::validator_instance::source_draw(const noice::validation::item &item, bool collides)
+{
+	NOICE_PROFILE_SCOPE(source_draw);
+	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_DEFAULT, "source_draw");
 
-		this->_hit_source_names.push_back(std::string(src_name));
-	}
+	matrix4 parentTransform;
+	from_transform(parentTransform, item.parent_transform);
 
-	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_DEFAULT, "source_draw");
+	// Composed transform of the enclosing groups, identity for top level items
+	gs_matrix_push();
+	gs_matrix_mul(&parentTransform);
 
 	matrix4 boxTransform;
-	obs_sceneitem_get_box_transform(item, &boxTransform);
+	from_transform(boxTransform, item.local_box_transform);
 
 	matrix4 curTransform;
 	vec2 boxScale;
 	gs_matrix_get(&curTransform);
-	obs_sceneitem_get_box_scale(item, &boxScale);
+	vec2_set(&boxScale, item.box_scale.x, item.box_scale.y);
 
 	boxScale.x *= curTransform.x.x;
 	boxScale.y *= curTransform.y.y;
@@ -499,13 +198,14 @@ void noice::source::validator_instance::source_draw(obs_sceneitem_t *item, bool
 	gs_effect_t *eff = gs_get_effect();
 	gs_eparam_t *colParam = gs_effect_get_param_by_name(eff, "color");
 
-	if (hits == 0)
+	if (!collides)
 		gs_effect_set_vec4(colParam, &_color_source[0]);
 	else
 		gs_effect_set_vec4(colParam, &_color_source_collides[0]);
 
 	DrawRect(HANDLE_RADIUS / 2, boxScale);
 
+	gs_matrix_pop();
 	gs_matrix_pop();
 	GS_DEBUG_MARKER_END();
 }
@@ -563,7 +263,11 @@ void noice::source::validator_instance::sceneitem_set_name(bool deferred)
 	_refresh_sceneitem = false;
 
 	bool can_update_source_names = noice::configuration::instance()->can_update_source_names();
-	std::string verbose_name = _game ? _game->name_verbose : _game_name;
+	std::string verbose_name;
+	{
+		std::unique_lock<std::mutex> lock(_game_lock);
+		verbose_name = _game ? _game->name_verbose : _game_name;
+	}
 
 	// SLOBS uses plugin_id_GUID as a source name, expect instabilities if you rename things
 	if (can_update_source_names) {
@@ -640,35 +344,30 @@ void noice::source::validator_instance::sceneitem_set_position(obs_sceneitem_t *
 	obs_data_release(settings);
 }
 
-static bool enum_validator_position(obs_scene_t *scene, obs_sceneitem_t *item, void *param)
+// We need to be on top in order to hilight issues by drawing on top of other sources
+// Handle sorting in two passes to avoid position fighting between scene items
+void noice::source::validator_instance::sort_sceneitems(obs_scene_t *scene)
 {
-	int pass = (int)(intptr_t)param;
-
-	if (obs_sceneitem_is_group(item)) {
-		obs_sceneitem_group_enum_items(item, enum_validator_position, param);
-		return true;
-	}
+	auto registry = validator_registry::instance();
+	if (!registry || !scene)
+		return;
 
 	// TODO: obs_source_showing?
-	obs_source_t *source = obs_sceneitem_get_source(item);
-	if (!strcmp(obs_source_get_id(source), NOICE_VALIDATOR_PLUGIN_ID)) {
-		noice::source::validator_instance *instance =
-			reinterpret_cast<noice::source::validator_instance *>(obs_obj_get_data(source));
-		if (instance != nullptr) {
+	std::vector<obs_sceneitem_t *> items = registry->validator_items(obs_scene_get_source(scene));
+	for (int pass = 1; pass <= 2; pass++) {
+		for (obs_sceneitem_t *item : items) {
+			noice::source::validator_instance *instance =
+				reinterpret_cast<noice::source::validator_instance *>(obs_obj_get_data(obs_sceneitem_get_source(item)));
+			if (instance == nullptr)
+				continue;
 			instance->sceneitem_set_position(item, pass);
 			if (pass == 2)
 				instance->sceneitem_set_transform(item);
 		}
 	}
-	return true;
-}
 
-// We need to be on top in order to hilight issues by drawing on top of other sources
-// Handle sorting in two passes to avoid position fighting between scene items
-void noice::source::validator_instance::sort_sceneitems(obs_scene_t *scene)
-{
-	obs_scene_enum_items(scene, enum_validator_position, (void *)(intptr_t)1);
-	obs_scene_enum_items(scene, enum_validator_position, (void *)(intptr_t)2);
+	for (obs_sceneitem_t *item : items)
+		obs_sceneitem_release(item);
 }
 
 static void sceneitem_renamed(void *param, calldata_t *data)
@@ -742,18 +441,19 @@ void noice::source::validator_instance::update_game_prop(obs_property_t *list)
 
 	for (auto game_it : gm->get_games()) {
 		const char *name = game_it.c_str();
-		auto game = gm->get_game(name);
+		// Listing only needs labels, don't materialize every game's regions
+		std::string name_verbose = gm->get_game_name_verbose(game_it);
 
-		if (game == nullptr)
+		if (name_verbose.empty())
 			continue;
 
-		bool available = !gm->is_game_acquired(game, _source_guid);
+		bool available = !gm->is_game_acquired(game_it, _source_guid);
 
 #if 0
 		DLOG_CTX_INFO(this, "--- game: %s available: %d", name, available);
 #endif
 		if (available)
-			obs_property_list_add_string(list, game->name_verbose.c_str(), name);
+			obs_property_list_add_string(list, name_verbose.c_str(), name);
 	}
 }
 
@@ -763,9 +463,14 @@ bool noice::source::validator_instance::update_hud_scale_prop(obs_property_t *pr
 	bool hud_available = false;
 	noice::in_game_hud_scale hud;
 
-	if (_game && _game->disabled == false) {
+	std::shared_ptr<noice::game> game;
+	{
+		std::unique_lock<std::mutex> lock(_game_lock);
+		game = _game;
+	}
+	if (game && game->disabled == false) {
 		game_selected = true;
-		hud = _game->in_game_hud;
+		hud = game->in_game_hud;
 	}
 
 	// Not all games support in-game user setting for UI HUD scaling
@@ -780,6 +485,17 @@ bool noice::source::validator_instance::update_hud_scale_prop(obs_property_t *pr
 obs_properties_t *noice::source::validator_factory::get_properties2(noice::source::validator_instance *instance)
 {
 	CALL_ENTRY(instance);
+
+	// Properties show the source settings, bring a pending set_game into them first
+	if (instance) {
+		std::unique_lock<std::mutex> lock(instance->_game_lock);
+		if (instance->_settings_dirty) {
+			obs_data_t *settings = obs_source_get_settings(instance->_source);
+			instance->persist_game(settings);
+			obs_data_release(settings);
+		}
+	}
+
 	obs_properties_t *props = obs_properties_create();
 	std::string game_label = noice::string_format("%s", obs_module_text("Noice.Game"));
 
@@ -820,23 +536,6 @@ noice::source::validator_instance::validator_instance(obs_data_t *data, obs_sour
 	_source = self;
 	CALL_ENTRY(this);
 
-	_main_video_sources = std::make_shared<std::map<std::string, bool>>();
-	auto &map = *(_main_video_sources.get());
-
-	map[NOICE_VALIDATOR_PLUGIN_ID] = true;
-	// Win
-	map["monitor_capture"] = true;
-	map["game_capture"] = true;
-	// Mac
-	map["display_capture"] = true;
-	// Win & Mac
-	map["window_capture"] = true;
-	// Linux
-	map["pipewire-desktop-capture-source"] = true;
-	map["pipewire-window-capture-source"] = true;
-	map["xcomposite_input"] = true;
-	map["xshm_input"] = true;
-
 	vec2_set(&_info.pos, 0.0f, 0.0f);
 	_info.rot = 0.0f;
 	vec2_set(&_info.scale, 1.0f, 1.0f);
@@ -850,13 +549,34 @@ noice::source::validator_instance::validator_instance(obs_data_t *data, obs_sour
 	_crop.right = 0;
 	_crop.bottom = 0;
 
-	matrix4_identity(&_parent_transform);
-
 	_ovi = {};
 	_ovi.base_width = 1;
 	_ovi.base_height = 1;
 
+	_hud_scale = 1.0f;
+	_settings_dirty = false;
+	_regions = std::make_shared<validator_regions>();
+
+	_engine = std::make_unique<noice::validation::engine>(
+		[](std::function<void()> task) {
+			auto st = scene_tracker::instance();
+			// Plugin unloading, nobody is listening anymore
+			if (!st)
+				return;
+			st->queue_worker_task(
+				[](void *param) {
+					std::unique_ptr<std::function<void()>> task(reinterpret_cast<std::function<void()> *>(param));
+					(*task)();
+				},
+				new std::function<void()>(std::move(task)));
+		},
+		[](const noice::validation::occlusion_event &event) {
+			auto st = scene_tracker::instance();
+			return st ? st->push_occlusion_event(event) : true;
+		});
+
 	_current_enum_scene = nullptr;
+	_rendered = false;
 
 	auto cfg = noice::configuration::instance();
 	if (cfg->can_update_source_names())
@@ -869,12 +589,20 @@ noice::source::validator_instance::validator_instance(obs_data_t *data, obs_sour
 	signal_handler_connect(obs_source_get_signal_handler(_source), "rename", sceneitem_renamed, this);
 	signal_handler_connect(cfg->get_signal_handler(), "service", service_changed, this);
 	update(data);
+
+	auto registry = validator_registry::instance();
+	if (registry)
+		registry->add(_source, this);
 }
 
 noice::source::validator_instance::~validator_instance()
 {
 	CALL_ENTRY(this);
 
+	auto registry = validator_registry::instance();
+	if (registry)
+		registry->remove(_source);
+
 	obs_weak_source_release(_current_enum_scene);
 	_current_enum_scene = nullptr;
 
@@ -886,15 +614,14 @@ noice::source::validator_instance::~validator_instance()
 		signal_handler_disconnect(cfg->get_signal_handler(), "service", service_changed, this);
 	}
 
-	if (_game) {
-		if (gm != nullptr) {
-			gm->release_game(_game, _source_guid);
-		}
+	std::shared_ptr<noice::game> game;
+	{
+		std::unique_lock<std::mutex> lock(_game_lock);
+		game = _game;
 		_game = nullptr;
 	}
-	if (_main_video_sources) {
-		_main_video_sources = nullptr;
-	}
+	if (game && gm != nullptr)
+		gm->release_game(game, _source_guid);
 }
 
 void noice::source::validator_instance::update_current_enum_scene()
@@ -938,45 +665,25 @@ void noice::source::validator_instance::update(obs_data_t *data)
 	uint32_t color_source = (uint32_t)obs_data_get_int(data, "color_source");
 	uint32_t color_source_collides = (uint32_t)obs_data_get_int(data, "color_source_collides");
 
-	if (_game_name != game_name) {
-		sceneitem_set_name(true);
-
-		auto gm = noice::game_manager::instance();
-
-		// hud_scale is serialized into game specific sources, but saving the last
-		// known game specific value during runtime helps when rapidly changing
-		// between games at the properties window
-		if (_game != nullptr) {
-			_game->in_game_hud.value = hud_scale;
-			gm->release_game(_game, _source_guid);
-		}
-		if (!_game_name.empty())
-			DLOG_CTX_INFO(this, "current game: %s -> %s", _game_name.c_str(), game_name.c_str());
-
-		_game_name = game_name;
-		_game = gm->get_game(_game_name);
-
-		if (_game != nullptr) {
-			gm->acquire_game(_game, _source_guid);
-			_game->reset_regions = true;
-
-			// We might have inherited scale from another game with different min/max/step values
-			float new_scale = _game->in_game_hud.clamp_value();
-			if (hud_scale != new_scale) {
-				hud_scale = new_scale;
-				obs_data_set_double(data, "hud_scale", hud_scale);
-			}
+	std::unique_lock<std::mutex> lock(_game_lock);
+	if (_settings_dirty) {
+		// Settings still hold the game from before set_game, unless it has been changed since
+		if (game_name == _settings_game_name) {
+			persist_game(data);
+			game_name = _game_name;
+			hud_scale = _hud_scale;
 		}
-
-		obs_data_set_string(data, "prev_game", game_name.c_str());
+		_settings_dirty = false;
 	}
+	_settings_game_name = game_name;
 
-	if (_game) {
-		if (_game->in_game_hud.value != hud_scale) {
-			_game->in_game_hud.value = hud_scale;
-			_game->reset_regions = true;
-		}
+	if (_game_name != game_name) {
+		switch_game(game_name, hud_scale, data);
+	} else if (_hud_scale != hud_scale) {
+		_hud_scale = hud_scale;
+		request_realign();
 	}
+	lock.unlock();
 
 	_draw_all_regions = draw_all_regions;
 	_debug_sources = debug_sources;
@@ -1000,6 +707,68 @@ void noice::source::validator_instance::update(obs_data_t *data)
 	}
 }
 
+void noice::source::validator_instance::switch_game(const std::string &game_name, float hud_scale, obs_data_t *data)
+{
+	sceneitem_set_name(true);
+
+	auto gm = noice::game_manager::instance();
+
+	// hud_scale is serialized into game specific sources, but saving the last
+	// known game specific value during runtime helps when rapidly changing
+	// between games at the properties window
+	if (_game != nullptr) {
+		_hud_scale_memory[_game_name] = hud_scale;
+		gm->release_game(_game, _source_guid);
+	}
+	if (!_game_name.empty())
+		DLOG_CTX_INFO(this, "current game: %s -> %s", _game_name.c_str(), game_name.c_str());
+
+	_game_name = game_name;
+	_game = gm->get_game(_game_name);
+
+	if (_game != nullptr) {
+		gm->acquire_game(_game, _source_guid);
+
+		noice::in_game_hud_scale hud = _game->in_game_hud;
+		auto search = _hud_scale_memory.find(_game_name);
+		if (search != _hud_scale_memory.end())
+			hud.value = search->second;
+
+		// We might have inherited scale from another game with different min/max/step values
+		float new_scale = hud.clamp_value();
+		if (hud_scale != new_scale) {
+			hud_scale = new_scale;
+			if (data)
+				obs_data_set_double(data, "hud_scale", hud_scale);
+		}
+	}
+
+	if (data)
+		obs_data_set_string(data, "prev_game", game_name.c_str());
+	_hud_scale = hud_scale;
+	request_realign();
+}
+
+void noice::source::validator_instance::persist_game(obs_data_t *data)
+{
+	obs_data_set_string(data, "game", _game_name.c_str());
+	obs_data_set_string(data, "prev_game", _game_name.c_str());
+	obs_data_set_double(data, "hud_scale", _hud_scale);
+	_settings_game_name = _game_name;
+	_settings_dirty = false;
+}
+
+bool noice::source::validator_instance::set_game(const std::string &game_name)
+{
+	std::unique_lock<std::mutex> lock(_game_lock);
+	if (_game_name == game_name)
+		return false;
+
+	switch_game(game_name, _hud_scale, nullptr);
+	_settings_dirty = true;
+	return true;
+}
+
 bool noice::source::validator_instance::validate_game_name_availability(obs_data_t *data)
 {
 	auto gm = noice::game_manager::instance();
@@ -1007,26 +776,32 @@ bool noice::source::validator_instance::validate_game_name_availability(obs_data
 	std::string new_game_name;
 	bool refresh = false;
 
+	std::string current_game_name;
+	{
+		std::unique_lock<std::mutex> lock(_game_lock);
+		current_game_name = _game_name;
+	}
+
 	if (game_name.rfind("__refresh_list__", 0) == 0) {
 		// SLOBS workaround trigger for property settings being out of date
-		if (_game_name.empty()) {
+		if (current_game_name.empty()) {
 			new_game_name = obs_data_get_string(data, "prev_game");
 		} else {
-			new_game_name = _game_name;
+			new_game_name = current_game_name;
 			obs_data_set_string(data, "prev_game", new_game_name.c_str());
 			refresh = true;
 		}
 	} else if (gm->is_game_acquired(game_name, _source_guid)) {
 		// We tried to select a game that was already acquired by someone else, property list out of date?
-		new_game_name = _game_name;
+		new_game_name = current_game_name;
 		if (!new_game_name.empty() && gm->is_game_acquired(new_game_name, _source_guid)) {
 			new_game_name = NOICE_PLACEHOLDER_GAME_NAME;
 		}
 	}
 
 	if (!new_game_name.empty()) {
-		DLOG_CTX_INFO(this, "Reset game: %s (was: %s, attempted to set: %s) Refresh: %d", new_game_name.c_str(), _game_name.c_str(),
-			      game_name.c_str(), refresh);
+		DLOG_CTX_INFO(this, "Reset game: %s (was: %s, attempted to set: %s) Refresh: %d", new_game_name.c_str(),
+			      current_game_name.c_str(), game_name.c_str(), refresh);
 		obs_data_set_string(data, "game", new_game_name.c_str());
 	}
 	return refresh;
@@ -1065,7 +840,12 @@ bool noice::source::validator_instance::content_settings_changed(obs_properties_
 	return true;
 }
 
-void noice::source::validator_instance::save(obs_data_t *) {}
+void noice::source::validator_instance::save(obs_data_t *data)
+{
+	std::unique_lock<std::mutex> lock(_game_lock);
+	if (_settings_dirty)
+		persist_game(data);
+}
 
 void noice::source::validator_instance::activate()
 {
@@ -1098,45 +878,95 @@ std::uint32_t noice::source::validator_instance::get_height()
 	return _ovi.base_height;
 }
 
-void noice::source::validator_instance::video_tick(float_t seconds)
+struct realign_job {
+	std::shared_ptr<noice::source::validator_regions> target;
+	std::shared_ptr<noice::game> game;
+	uint32_t base_width;
+	uint32_t base_height;
+	float hud_scale;
+	uint64_t generation;
+};
+
+static void realign_task(void *param)
 {
-	uint64_t frame_time = obs_get_video_frame_time();
+	std::unique_ptr<realign_job> job(reinterpret_cast<realign_job *>(param));
 
-	if (_refresh_sceneitem) {
-		_game = noice::game_manager::instance()->get_game(_game_name);
-		sceneitem_set_name();
+	// A newer request has been made in the meantime
+	if (job->target->generation != job->generation)
+		return;
+
+	auto regions = std::make_shared<noice::aligned_regions>();
+	regions->game = job->game;
+	regions->regions = job->game->regions();
+	regions->boxes = job->game->align_regions(job->base_width, job->base_height, job->hud_scale);
+	regions->base_width = job->base_width;
+	regions->base_height = job->base_height;
+	regions->hud_scale = job->hud_scale;
+	if (!regions->regions)
+		regions->regions = std::make_shared<const std::vector<noice::region>>();
+
+	std::unique_lock<std::mutex> lock(job->target->lock);
+	if (job->target->generation == job->generation) {
+		std::atomic_store(&job->target->front, std::shared_ptr<const noice::aligned_regions>(regions));
+		job->target->front_generation = job->generation;
 	}
+}
 
-	_last_time = frame_time;
+void noice::source::validator_instance::request_realign()
+{
+	queue_realign(_game, _hud_scale, false);
 }
 
-void noice::source::validator_instance::video_render(gs_effect_t *)
+void noice::source::validator_instance::queue_realign(std::shared_ptr<noice::game> game, float hud_scale, bool if_idle)
 {
-	update_current_enum_scene();
+	std::unique_lock<std::mutex> lock(_regions->lock);
 
-	bool collect_hit_source_names = scene_tracker::instance()->needs_diagnostics(diagnostics_type::hit_source_names);
+	// Render thread only asks for a canvas change, leave it be if a settings change is on the way
+	if (if_idle && _regions->front_generation != _regions->generation)
+		return;
 
 	struct obs_video_info ovi = {};
 	if (!obs_get_video_info(&ovi))
 		return;
 
-	if (!_game || (_game && _game->disabled)) {
-		_ovi = ovi;
+	uint64_t generation = ++_regions->generation;
+
+	if (!game || game->disabled) {
+		std::atomic_store(&_regions->front, std::shared_ptr<const noice::aligned_regions>());
+		_regions->front_generation = generation;
 		return;
 	}
 
-	_game->reset_regions |= compare_ovi_state(_ovi, ovi);
-	_ovi = ovi;
+	realign_job *job = new realign_job();
+	job->target = _regions;
+	job->game = game;
+	job->base_width = ovi.base_width;
+	job->base_height = ovi.base_height;
+	job->hud_scale = hud_scale;
+	job->generation = generation;
 
-	if (_game->reset_regions) {
-		_game->reset_regions = false;
+#if 0
+	DLOG_CTX_INFO(this, "realign %ux%u scale: %f generation: %" PRIu64, job->base_width, job->base_height, job->hud_scale,
+		      generation);
+#endif
+	scene_tracker::instance()->queue_worker_task(realign_task, job);
+}
 
-		DLOG_CTX_INFO(this, "ovi: base %dx%d output %dx%d scale: %f", _ovi.base_width, _ovi.base_height, _ovi.output_width,
-			      _ovi.output_height, _game->in_game_hud.value);
-		for (noice::region &region : *_game->regions())
-			region.align_box(_ovi, _game->in_game_hud.value);
+void noice::source::validator_instance::video_tick(float_t seconds)
+{
+	uint64_t frame_time = obs_get_video_frame_time();
+
+	if (_refresh_sceneitem) {
+		{
+			std::unique_lock<std::mutex> lock(_game_lock);
+			_game = noice::game_manager::instance()->get_game(_game_name);
+			request_realign();
+		}
+		sceneitem_set_name();
 	}
 
+	_last_time = frame_time;
+
 #if 1
 	// Add some pulse for the collision color used
 	const int step_range = 30;
@@ -1155,6 +985,85 @@ void noice::source::validator_instance::video_render(gs_effect_t *)
 	}
 #endif
 
+	// Hand the scene over to the validation engine, video_render only draws the latest result
+	std::shared_ptr<const noice::aligned_regions> regions = std::atomic_load(&_regions->front);
+	bool rendered = _rendered;
+	_rendered = false;
+
+	// No game, let the tracker report every open occlusion as stopped
+	if (!regions) {
+		_validation_source = nullptr;
+		_validation_regions = nullptr;
+		_engine->submit(nullptr, nullptr, noice::validation::options(), frame_time);
+		return;
+	}
+
+	auto st = scene_tracker::instance();
+	if (_validation_source != regions) {
+		auto rects = std::make_shared<std::vector<noice::validation::region>>();
+		rects->reserve(regions->boxes->size());
+		for (size_t i = 0; i < regions->boxes->size(); i++) {
+			const noice::region_rect &box = (*regions->boxes)[i];
+			const noice::region &region = (*regions->regions)[i];
+			std::string name = regions->game->name + "/" + region.game_state + "/" + region.region_name;
+			rects->push_back({{box.x, box.y, box.w, box.h}, region.min_overlap * fabsf(box.w * box.h), st->intern_region(name)});
+		}
+
+		_validation_source = regions;
+		_validation_regions = rects;
+	}
+
+	noice::validation::options opts;
+	opts.debug_sources = _debug_sources;
+
+	// The enum scene is only known while rendering, use the one seen during the last frame.
+	// It goes stale once the source stops being drawn, validate an empty scene then.
+	std::shared_ptr<const noice::validation::scene_snapshot> snapshot;
+	obs_scene_t *scene = rendered ? current_enum_scene() : nullptr;
+	if (scene)
+		snapshot = scene_view_cache::instance()->get(scene, _ovi.base_width, _ovi.base_height);
+	obs_scene_release(scene);
+
+	_engine->submit(snapshot, _validation_regions, opts, frame_time);
+}
+
+std::shared_ptr<const noice::validation::result> noice::source::validator_instance::latest_result()
+{
+	return _engine->latest();
+}
+
+void noice::source::validator_instance::video_render(gs_effect_t *)
+{
+	NOICE_PROFILE_SCOPE(video_render);
+	NOICE_TRACE_SCOPE("video_render");
+	update_current_enum_scene();
+	_rendered = true;
+
+	struct obs_video_info ovi = {};
+	if (!obs_get_video_info(&ovi))
+		return;
+
+	bool ovi_changed = compare_ovi_state(_ovi, ovi);
+	_ovi = ovi;
+
+	if (ovi_changed)
+		DLOG_CTX_INFO(this, "ovi: base %dx%d output %dx%d", _ovi.base_width, _ovi.base_height, _ovi.output_width,
+			      _ovi.output_height);
+
+	std::shared_ptr<const noice::aligned_regions> regions = std::atomic_load(&_regions->front);
+	if (!regions)
+		return;
+
+	// Keep drawing the previous alignment until the worker has swapped in the new one
+	if (regions->base_width != _ovi.base_width || regions->base_height != _ovi.base_height)
+		queue_realign(regions->game, regions->hud_scale, true);
+
+	// Validation runs off the graphics thread, every view showing the source just draws
+	// the latest published result
+	auto result = _engine->latest();
+	if (!result || !result->snapshot || !result->regions)
+		return;
+
 	const bool previous = gs_framebuffer_srgb_enabled();
 	gs_enable_framebuffer_srgb(_linear_srgb);
 
@@ -1164,39 +1073,17 @@ void noice::source::validator_instance::video_render(gs_effect_t *)
 	gs_technique_begin(tech);
 	gs_technique_begin_pass(tech, 0);
 
-	obs_scene_t *scene = current_enum_scene();
-	if (scene) {
-		gs_matrix_push();
-
-		if (collect_hit_source_names) {
-			_hit_source_names.clear();
-		}
+	gs_matrix_push();
 
-		auto source_draw_item = [this, collect_hit_source_names](obs_sceneitem_t *item) {
-			source_draw(item, collect_hit_source_names);
-		};
-		using source_draw_item_t = decltype(source_draw_item);
-
-		obs_scene_enum_items(
-			scene,
-			[](obs_scene_t *, obs_sceneitem_t *item, void *param) {
-				source_draw_item_t *func;
-				func = reinterpret_cast<source_draw_item_t *>(param);
-				(*func)(item);
-				return true;
-			},
-			&source_draw_item);
-
-		if (collect_hit_source_names) {
-			scene_tracker::instance()->add_hit_item_source_names(_hit_source_names);
-		}
+	for (const noice::validation::item_result &item : result->items) {
+		source_draw(result->snapshot->items[item.index], item.collides);
+	}
 
-		for (noice::region &region : *_game->regions()) {
-			region_draw(region);
-		}
-		gs_matrix_pop();
+	const std::vector<noice::validation::region> &boxes = *result->regions;
+	for (size_t i = 0; i < boxes.size(); i++) {
+		region_draw(boxes[i].box, result->region_hits[i]);
 	}
-	obs_scene_release(scene);
+	gs_matrix_pop();
 
 	gs_load_vertexbuffer(nullptr);
 
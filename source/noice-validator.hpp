@@ -14,22 +14,38 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #pragma once
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include "common.hpp"
 #include <obs.h>
 #include <graphics/matrix4.h>
 #include <string>
 #include <utility>
 #include "obs/obs-source-factory.hpp"
+#include "validation.hpp"
 
 namespace noice {
 class game;
 class region;
+struct region_rect;
+struct aligned_regions;
 }
 
 namespace noice::source {
 class validator_instance;
 
+// Double buffered aligned regions of a validator. video_render only reads the front
+// buffer, realignment builds the back buffer on the worker queue and swaps it in.
+struct validator_regions {
+	std::mutex lock;
+	std::shared_ptr<const noice::aligned_regions> front;
+	std::atomic<uint64_t> generation;
+	std::atomic<uint64_t> front_generation;
+
+	validator_regions() : front(nullptr), generation(0), front_generation(0) {}
+};
+
 class validator_factory : public obs::source_factory<noice::source::validator_factory, noice::source::validator_instance> {
 public:
 	validator_factory();
@@ -50,18 +66,28 @@ class validator_instance : public obs::source_instance {
 
 	uint64_t _last_time;
 
-	std::shared_ptr<std::map<std::string, bool>> _main_video_sources;
-
+	// Guards the game selection below, set_game comes in from the graphics thread while the
+	// settings are handled on the UI thread
+	std::mutex _game_lock;
 	std::string _game_name;
+	// Game in the source settings, behind _game_name while a set_game is not persisted yet
+	std::string _settings_game_name;
+	bool _settings_dirty;
 	std::shared_ptr<noice::game> _game;
+	float _hud_scale;
+	std::map<std::string, float> _hud_scale_memory;
+
+	std::shared_ptr<validator_regions> _regions;
+
+	std::unique_ptr<noice::validation::engine> _engine;
+	std::shared_ptr<const noice::aligned_regions> _validation_source;
+	std::shared_ptr<const std::vector<noice::validation::region>> _validation_regions;
 
 	obs_video_info _ovi;
 
 	bool _draw_all_regions;
 	bool _debug_sources;
 
-	std::vector<std::string> _hit_source_names;
-
 	struct vec4 _color_region[2];
 	struct vec4 _color_source[2];
 	struct vec4 _color_source_collides[2];
@@ -69,11 +95,12 @@ class validator_instance : public obs::source_instance {
 
 	struct obs_transform_info _info;
 	struct obs_sceneitem_crop _crop;
-	struct matrix4 _parent_transform;
 
 	obs_source_t *_source;
 	std::string _source_guid;
 	obs_weak_source_t *_current_enum_scene;
+	// Set by video_render, a source not drawn during the last frame has nothing to validate
+	bool _rendered;
 
 	friend class validator_factory;
 
@@ -84,20 +111,25 @@ private:
 
 	bool content_settings_changed(obs_properties_t *props, obs_property_t *list, obs_data_t *settings);
 
-	bool sceneitem_has_canvas_coverage(obs_sceneitem_t *item, int coverage_requirement);
-
-	bool sceneitem_is_main_video_source(obs_sceneitem_t *item);
+	void region_draw(const noice::validation::rect &box, int region_hits);
 
-	void region_validate(noice::region &region, obs_sceneitem_t *item, int &hits);
+	// Callers hold _game_lock
+	void request_realign();
 
-	void region_draw(noice::region &region);
+	void queue_realign(std::shared_ptr<noice::game> game, float hud_scale, bool if_idle);
 
-	void source_draw(obs_sceneitem_t *item, bool collect_hit_source_names);
+	void source_draw(const noice::validation::item &item, bool collides);
 
 	void update_game_prop(obs_property_t *prop);
 
 	bool update_hud_scale_prop(obs_property_t *prop);
 
+	// Callers hold _game_lock
+	void switch_game(const std::string &game_name, float hud_scale, obs_data_t *data);
+
+	// Callers hold _game_lock
+	void persist_game(obs_data_t *data);
+
 	bool validate_game_name_availability(obs_data_t *data);
 
 	bool try_source_candidate_name(std::string candidate);
@@ -130,6 +162,13 @@ public:
 
 	void video_render(gs_effect_t *effect) override;
 
+	// Switches the game without a settings round trip, settings are written on the next
+	// save or update. Returns false when the game was already current.
+	bool set_game(const std::string &game_name);
+
+	// Latest published validation, safe to call from any thread
+	std::shared_ptr<const noice::validation::result> latest_result();
+
 	void sceneitem_set_name(bool deferred = false);
 
 	void sceneitem_set_transform(obs_sceneitem_t *item);
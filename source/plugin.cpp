@@ -14,14 +14,20 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <obs-module.h>
+#include <cstdlib>
 #include <stdexcept>
 #include "version.h"
 #include "common.hpp"
 #include "game.hpp"
 #include "noice-validator.hpp"
 #include "scene-tracker.hpp"
+#include "source-classifier.hpp"
+#include "scene-view.hpp"
+#include "validator-registry.hpp"
 #include "noice-bridge.hpp"
 #include "obs-bridge.hpp"
+#include "startup.hpp"
+#include "util/util-trace.hpp"
 
 OBS_DECLARE_MODULE()
 OBS_MODULE_AUTHOR("Noice");
@@ -34,28 +40,48 @@ MODULE_EXPORT bool obs_module_load()
 	if (!added)
 		return false;
 
+	// Record from the very start, e.g. to trace plugin startup
+	if (std::getenv("NOICE_TRACE"))
+		noice::util::trace::start();
+
+	noice::util::log::initialize();
+	signal_handler_add(obs_get_signal_handler(), "void noice_ready()");
+
 	try {
-		obs::bridge::initialize();
-		noice::bridge::initialize();
-		noice::auth::initialize();
-		noice::game_manager::initialize();
-		noice::configuration::initialize();
-		noice::configuration::instance()->refresh();
+		// Only what sources need once OBS creates them, everything touching the network or
+		// disk beyond our own config runs on the startup lane
+		noice::startup::run(noice::startup::stage::core, []() {
+			obs::bridge::initialize();
+			noice::bridge::initialize();
+			noice::auth::initialize();
+			noice::game_manager::initialize();
+			noice::configuration::initialize();
 
-		// Retrieve unique Machine Id.
-		noice::get_unique_identifier();
+			noice::source::source_classifier::initialize();
+			noice::source::scene_view_cache::initialize();
+			noice::source::validator_registry::initialize();
+			noice::source::scene_tracker::initialize();
 
-		noice::source::scene_tracker::initialize();
+			{
+				static auto validators = std::make_shared<noice::source::validator_factory>();
+			}
+		});
+		// Retrieve unique Machine Id. Inline, docks read it on the UI thread and must not race
+		// the first run into generating one of their own.
+		noice::startup::run(noice::startup::stage::identity, []() { noice::get_unique_identifier(); });
 
-		{
-			static auto validators = std::make_shared<noice::source::validator_factory>();
-		}
+		noice::startup::defer(noice::startup::stage::config, []() { noice::configuration::instance()->refresh(true); });
+		noice::startup::defer(noice::startup::stage::scene_collection,
+				      []() { noice::source::scene_tracker::instance()->start_scenecollection_watch(); });
+		noice::startup::start();
 		return true;
 	} catch (const std::exception &ex) {
 		DLOG_ERROR("Failed to load plugin due to error: %s", ex.what());
+		noice::util::log::finalize();
 		return false;
 	} catch (...) {
 		DLOG_ERROR("Failed to load plugin.");
+		noice::util::log::finalize();
 		return false;
 	}
 
@@ -67,7 +93,11 @@ MODULE_EXPORT void obs_module_unload()
 	DLOG_INFO("Unloading");
 
 	try {
+		noice::startup::finish();
 		noice::source::scene_tracker::finalize();
+		noice::source::validator_registry::finalize();
+		noice::source::scene_view_cache::finalize();
+		noice::source::source_classifier::finalize();
 		noice::configuration::finalize();
 		noice::game_manager::finalize();
 		noice::bridge::finalize();
@@ -75,6 +105,8 @@ MODULE_EXPORT void obs_module_unload()
 	} catch (...) {
 		DLOG_ERROR("Failed to unload plugin.");
 	}
+
+	noice::util::log::finalize();
 }
 
 MODULE_EXPORT const char *obs_module_description(void)
@@ -0,0 +1,56 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "scene-collection.hpp"
+#include "common.hpp"
+#include "util/util-profiler.hpp"
+#include <nlohmann/json.hpp>
+
+bool noice::source::parse_scenecollection(std::istream &input, scenecollection_names &out)
+{
+	NOICE_PROFILE_SCOPE(scenecollection_parse);
+	scenecollection_names names;
+
+	try {
+		nlohmann::json data;
+		data = nlohmann::json::parse(input);
+
+		nlohmann::json obj = data["sources"];
+		for (auto items_it : obj["items"]) {
+			auto item_obj = items_it.get<nlohmann::json::object_t>();
+			std::string guid = item_obj["id"].get<std::string>();
+			std::string name = item_obj["name"].get<std::string>();
+
+			names.guid2source[guid] = name;
+			names.source2guid[name] = guid;
+		}
+
+		obj = data["scenes"];
+		for (auto items_it : obj["items"]) {
+			auto item_obj = items_it.get<nlohmann::json::object_t>();
+			std::string guid = item_obj["id"].get<std::string>();
+			std::string name = item_obj["name"].get<std::string>();
+
+			names.guid2source[guid] = name;
+			names.source2guid[name] = guid;
+		}
+	} catch (std::exception const &ex) {
+		DLOG_ERROR("JSON parse error: %s", ex.what());
+		return false;
+	}
+
+	out = std::move(names);
+	return true;
+}
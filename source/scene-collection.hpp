@@ -0,0 +1,32 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <istream>
+#include <map>
+#include <string>
+
+namespace noice::source {
+
+// Source and scene names by guid and back, as stored in a Streamlabs scene collection
+struct scenecollection_names {
+	std::map<std::string, std::string> guid2source;
+	std::map<std::string, std::string> source2guid;
+};
+
+// Reads the names from a scene collection file, out is left untouched on errors
+bool parse_scenecollection(std::istream &input, scenecollection_names &out);
+
+} // namespace noice::source
@@ -0,0 +1,230 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "scene-recording.hpp"
+#include <cstring>
+#include <type_traits>
+
+namespace validation = noice::validation;
+
+// Values are stored in host byte order, little endian on every platform OBS runs on
+static constexpr char MAGIC[4] = {'N', 'S', 'R', 'C'};
+static constexpr uint32_t VERSION = 1;
+
+// Bounds for counts read from a file, so a corrupt one fails instead of allocating wildly
+static constexpr uint32_t MAX_COUNT = 1 << 20;
+static constexpr uint32_t MAX_STRING = 256;
+
+uint32_t validation::scene_recording::intern_source_type(const std::string &type)
+{
+	for (size_t i = 0; i < source_types.size(); i++) {
+		if (source_types[i] == type)
+			return (uint32_t)i;
+	}
+	source_types.push_back(type);
+	return (uint32_t)(source_types.size() - 1);
+}
+
+#pragma mark Writing
+
+template<typename T> static void put(std::ostream &output, T value)
+{
+	static_assert(std::is_arithmetic<T>::value, "only plain numbers are stored as is");
+	char bytes[sizeof(T)];
+	memcpy(bytes, &value, sizeof(T));
+	output.write(bytes, sizeof(T));
+}
+
+static void put(std::ostream &output, const validation::point &p)
+{
+	put(output, p.x);
+	put(output, p.y);
+}
+
+static void put(std::ostream &output, const validation::transform &m)
+{
+	put(output, m.x);
+	put(output, m.y);
+	put(output, m.t);
+}
+
+static void put(std::ostream &output, const std::string &value)
+{
+	put(output, (uint32_t)value.size());
+	output.write(value.data(), (std::streamsize)value.size());
+}
+
+bool validation::write_recording(std::ostream &output, const scene_recording &recording)
+{
+	output.write(MAGIC, sizeof(MAGIC));
+	put(output, VERSION);
+
+	const video_info &video = recording.video;
+	put(output, video.base_width);
+	put(output, video.base_height);
+	put(output, video.output_width);
+	put(output, video.output_height);
+	put(output, video.fps_num);
+	put(output, video.fps_den);
+
+	put(output, (uint32_t)recording.source_types.size());
+	for (const std::string &type : recording.source_types)
+		put(output, type.substr(0, MAX_STRING));
+
+	put(output, (uint32_t)recording.regions.size());
+	for (const region &r : recording.regions) {
+		put(output, r.box.x);
+		put(output, r.box.y);
+		put(output, r.box.w);
+		put(output, r.box.h);
+		put(output, r.min_area);
+		put(output, r.id);
+	}
+
+	put(output, (uint32_t)recording.frames.size());
+	for (const recorded_frame &frame : recording.frames) {
+		put(output, frame.frame_time);
+		put(output, (uint32_t)frame.items.size());
+		for (const recorded_item &it : frame.items) {
+			put(output, it.entry.source_id);
+			put(output, it.entry.box_transform);
+			put(output, it.entry.parent_transform);
+			put(output, it.entry.local_box_transform);
+			put(output, it.entry.box_scale);
+			put(output, (int32_t)it.entry.coverage);
+			put(output, it.source_type);
+			put(output, it.source_width);
+			put(output, it.source_height);
+			put(output, (uint8_t)((it.visible ? 1 : 0) | (it.video ? 2 : 0) | (it.entry.main_video ? 4 : 0)));
+		}
+	}
+
+	return output.good();
+}
+
+#pragma mark Reading
+
+template<typename T> static bool get(std::istream &input, T &value)
+{
+	static_assert(std::is_arithmetic<T>::value, "only plain numbers are stored as is");
+	char bytes[sizeof(T)];
+	if (!input.read(bytes, sizeof(T)))
+		return false;
+	memcpy(&value, bytes, sizeof(T));
+	return true;
+}
+
+static bool get(std::istream &input, validation::point &p)
+{
+	return get(input, p.x) && get(input, p.y);
+}
+
+static bool get(std::istream &input, validation::transform &m)
+{
+	return get(input, m.x) && get(input, m.y) && get(input, m.t);
+}
+
+static bool get(std::istream &input, std::string &value)
+{
+	uint32_t size = 0;
+	if (!get(input, size) || size > MAX_STRING)
+		return false;
+	value.resize(size);
+	return size == 0 || (bool)input.read(&value[0], size);
+}
+
+static bool get_count(std::istream &input, uint32_t &count)
+{
+	return get(input, count) && count <= MAX_COUNT;
+}
+
+static bool get_item(std::istream &input, validation::recorded_item &it, size_t source_types)
+{
+	int32_t coverage = 0;
+	uint8_t flags = 0;
+	if (!get(input, it.entry.source_id) || !get(input, it.entry.box_transform) || !get(input, it.entry.parent_transform) ||
+	    !get(input, it.entry.local_box_transform) || !get(input, it.entry.box_scale) || !get(input, coverage) ||
+	    !get(input, it.source_type) || !get(input, it.source_width) || !get(input, it.source_height) || !get(input, flags))
+		return false;
+
+	it.entry.coverage = coverage;
+	it.visible = (flags & 1) != 0;
+	it.video = (flags & 2) != 0;
+	it.entry.main_video = (flags & 4) != 0;
+	return it.source_type < source_types;
+}
+
+bool validation::read_recording(std::istream &input, scene_recording &out)
+{
+	char magic[sizeof(MAGIC)];
+	uint32_t version = 0;
+	if (!input.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || !get(input, version) ||
+	    version != VERSION)
+		return false;
+
+	scene_recording recording;
+	video_info &video = recording.video;
+	if (!get(input, video.base_width) || !get(input, video.base_height) || !get(input, video.output_width) ||
+	    !get(input, video.output_height) || !get(input, video.fps_num) || !get(input, video.fps_den))
+		return false;
+
+	uint32_t count = 0;
+	if (!get_count(input, count))
+		return false;
+	recording.source_types.resize(count);
+	for (std::string &type : recording.source_types) {
+		if (!get(input, type))
+			return false;
+	}
+
+	if (!get_count(input, count))
+		return false;
+	recording.regions.resize(count);
+	for (region &r : recording.regions) {
+		if (!get(input, r.box.x) || !get(input, r.box.y) || !get(input, r.box.w) || !get(input, r.box.h) ||
+		    !get(input, r.min_area) || !get(input, r.id))
+			return false;
+	}
+
+	if (!get_count(input, count))
+		return false;
+	recording.frames.resize(count);
+	for (recorded_frame &frame : recording.frames) {
+		if (!get(input, frame.frame_time) || !get_count(input, count))
+			return false;
+		frame.items.resize(count);
+		for (recorded_item &it : frame.items) {
+			if (!get_item(input, it, recording.source_types.size()))
+				return false;
+		}
+	}
+
+	out = std::move(recording);
+	return true;
+}
+
+std::shared_ptr<validation::scene_snapshot> validation::frame_snapshot(const scene_recording &recording, const recorded_frame &frame)
+{
+	auto snapshot = std::make_shared<scene_snapshot>();
+	snapshot->frame_time = frame.frame_time;
+	snapshot->canvas_width = recording.video.base_width;
+	snapshot->canvas_height = recording.video.base_height;
+	snapshot->items.reserve(frame.items.size());
+	for (const recorded_item &it : frame.items) {
+		if (it.visible && it.video)
+			snapshot->items.push_back(it.entry);
+	}
+	return snapshot;
+}
@@ -0,0 +1,75 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "validation.hpp"
+
+// Scene layouts captured from a live session, so validation can be profiled and regression
+// tested against real scenes without OBS. Like validation, free of libobs types.
+namespace noice::validation {
+
+// The parts of obs_video_info that matter for validation
+struct video_info {
+	uint32_t base_width;
+	uint32_t base_height;
+	uint32_t output_width;
+	uint32_t output_height;
+	uint32_t fps_num;
+	uint32_t fps_den;
+};
+
+struct recorded_item {
+	item entry;
+	// Index into scene_recording::source_types
+	uint32_t source_type;
+	uint32_t source_width;
+	uint32_t source_height;
+	// Visible itself and in every group containing it
+	bool visible;
+	bool video;
+};
+
+struct recorded_frame {
+	uint64_t frame_time;
+	// Leaf items in draw order, groups are folded into the parent transforms
+	std::vector<recorded_item> items;
+};
+
+struct scene_recording {
+	video_info video;
+	std::vector<std::string> source_types;
+	// Regions validated at the time of the recording, in canvas pixels
+	std::vector<region> regions;
+	std::vector<recorded_frame> frames;
+
+	scene_recording() : video() {}
+
+	uint32_t intern_source_type(const std::string &type);
+};
+
+bool write_recording(std::ostream &output, const scene_recording &recording);
+
+// Reads a recording written by write_recording, out is left untouched on errors
+bool read_recording(std::istream &input, scene_recording &out);
+
+// What a validator sees of the frame: the visible video items
+std::shared_ptr<scene_snapshot> frame_snapshot(const scene_recording &recording, const recorded_frame &frame);
+
+} // namespace noice::validation
@@ -18,6 +18,15 @@
 #include "auth.hpp"
 #include "noice-validator.hpp"
 #include "game.hpp"
+#include "source-classifier.hpp"
+#include "validator-registry.hpp"
+#include "scene-collection.hpp"
+#include "scene-view.hpp"
+#include "startup.hpp"
+#include "util/util-json.hpp"
+#include "util/util-profiler.hpp"
+#include "util/util-trace.hpp"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <nlohmann/json.hpp>
@@ -38,7 +47,12 @@ static constexpr std::string_view NOICE_VALIDATOR_SOURCE_NAME_SINGLETON = "Noice
 
 constexpr float UPDATE_SELECTED_GAME_INTERVAL = 30.0f;
 constexpr float SEND_DIAGNOSTICS_INTERVAL = 10.0f;
+constexpr size_t OCCLUSION_EVENT_QUEUE_SIZE = 4096;
 constexpr float SCENE_CHECK_INTERVAL = 1.0f;
+// Most occluded pairs included in diagnostics and shown in the stats dock
+constexpr size_t OCCLUSION_STATS_LIMIT = 32;
+// Diagnostics bodies with a full set of occlusion stats stay below this
+constexpr size_t DIAGNOSTICS_BODY_RESERVE = 16384;
 
 noice::source::scene_tracker::~scene_tracker()
 {
@@ -46,6 +60,8 @@ noice::source::scene_tracker::~scene_tracker()
 	os_task_queue_destroy(_task_queue);
 	os_task_queue_wait(_diagnostics_task_queue);
 	os_task_queue_destroy(_diagnostics_task_queue);
+	os_task_queue_wait(_worker_task_queue);
+	os_task_queue_destroy(_worker_task_queue);
 	obs_remove_tick_callback(obs_tick_handler, this);
 
 	release_sources();
@@ -70,19 +86,39 @@ noice::source::scene_tracker::scene_tracker()
 	  _has_finished_loading(false),
 	  _task_queue(nullptr),
 	  _dmon_initialized(false),
-	  _current_scene_has_noice_validator(false)
+	  _occlusion_events(OCCLUSION_EVENT_QUEUE_SIZE),
+	  _occlusion_stats_streaming(false),
+	  _published_stats_observed(0),
+	  _current_scene_has_noice_validator(false),
+	  _diagnostics_requests(0),
+	  _diagnostics_generation(0),
+	  _diagnostics_reports(2),
+	  _queued_diagnostics(false)
 {
 	_task_queue = os_task_queue_create();
-	queue_task([](void *param) { os_set_thread_name("noice thread"); }, (void *)this, false);
+	queue_task(
+		[](void *param) {
+			os_set_thread_name("noice thread");
+			noice::util::trace::set_thread_name("noice thread");
+		},
+		(void *)this, false);
+	_diagnostics_body.reserve(DIAGNOSTICS_BODY_RESERVE);
 	_diagnostics_task_queue = os_task_queue_create();
-	queue_task([](void *param) { os_set_thread_name("noice diagnostics thread"); }, nullptr, false, _diagnostics_task_queue);
+	queue_task(
+		[](void *param) {
+			os_set_thread_name("noice diagnostics thread");
+			noice::util::trace::set_thread_name("noice diagnostics thread");
+		},
+		nullptr, false, _diagnostics_task_queue);
+	_worker_task_queue = os_task_queue_create();
+	queue_task(
+		[](void *param) {
+			os_set_thread_name("noice worker thread");
+			noice::util::trace::set_thread_name("noice worker thread");
+		},
+		nullptr, false, _worker_task_queue);
 
 	obs_add_tick_callback(obs_tick_handler, this);
-
-	auto cfg = noice::configuration::instance();
-	if (cfg && cfg->is_slobs()) {
-		scenecollection_watch();
-	}
 }
 
 #if ENABLE_SINGLETON_SOURCE
@@ -141,6 +177,8 @@ static void print_weak_source(const char *label, obs_weak_source_t *weak_source)
 
 void noice::source::scene_tracker::tick_handler()
 {
+	NOICE_PROFILE_SCOPE(tick_handler);
+	NOICE_TRACE_SCOPE("tick_handler");
 	// DLOG_INFO("tick_handler: --");
 	{
 		std::unique_lock<std::mutex> lock(_lock);
@@ -193,11 +231,17 @@ void noice::source::scene_tracker::tick_handler()
 		if (!obs_get_module("rtmp-services") || !obs_get_module("obs-outputs"))
 			return;
 
+		// Probing the service refreshes the config, which must not wait on the startup lane
+		if (!noice::startup::ready(noice::startup::stage::config))
+			return;
+
 		// first OBS_FRONTEND_EVENT_SCENE_COLLECTION_CLEANUP trigger equivalent
 		_startup_complete = true;
 		DLOG_INFO("tick_handler: STARTUP COMPLETE");
 
 		noice::configuration::instance()->probe_service_changed();
+
+		publish_occlusion_stats();
 	}
 
 	// Good enough to query program scene, but not preview
@@ -236,25 +280,12 @@ void noice::source::scene_tracker::tick_handler()
 	if (_frontend_scene_reset) {
 		DLOG_INFO("tick_handler: SCENE CHANGED");
 		_frontend_scene_reset = false;
-		_hit_source_names.clear();
+		clear_diagnostics();
 
 		obs_source_t *src = obs_weak_source_get_source(_current_output_source);
 		if (src) {
-			obs_scene_t *scene = obs_scene_from_source(src);
-			auto cb = [](obs_scene_t *scene, obs_sceneitem_t *item, void *param) -> bool {
-				obs_source_t *item_source = obs_sceneitem_get_source(item);
-				const char *src_id = obs_source_get_id(item_source);
-
-				if (src_id && !strcmp(src_id, "noice_validator")) {
-					auto st = reinterpret_cast<noice::source::scene_tracker *>(param);
-					st->set_current_scene_has_noice_validator(true);
-					return false;
-				}
-
-				return true;
-			};
-			set_current_scene_has_noice_validator(false);
-			obs_scene_enum_items(scene, cb, this);
+			auto registry = noice::source::validator_registry::instance();
+			set_current_scene_has_noice_validator(registry && registry->scene_has_validator(src));
 			obs_source_release(src);
 		}
 
@@ -278,6 +309,8 @@ void noice::source::scene_tracker::tick_handler()
 
 		noice::configuration::instance()->probe_service_changed();
 
+		publish_occlusion_stats();
+
 		{
 			std::unique_lock<std::mutex> lock(_selected_game_lock, std::try_to_lock);
 			if (lock.owns_lock()) {
@@ -291,6 +324,7 @@ void noice::source::scene_tracker::tick_handler()
 		}
 	}
 
+	occlusion_tick();
 	diagnostics_tick();
 	send_diagnostics_if_ready();
 
@@ -304,23 +338,123 @@ bool noice::source::scene_tracker::current_scene_has_noice_validator()
 
 void noice::source::scene_tracker::set_current_scene_has_noice_validator(bool has)
 {
-	std::unique_lock<std::mutex> lock(_diagnostics_lock);
-
 	_current_scene_has_noice_validator = has;
 }
 
-void noice::source::scene_tracker::add_hit_item_source_names(std::vector<std::string> &names)
+bool noice::source::scene_tracker::push_occlusion_event(const noice::validation::occlusion_event &event)
+{
+	return _occlusion_events.push(event);
+}
+
+uint32_t noice::source::scene_tracker::intern_region(std::string_view name)
+{
+	std::unique_lock<std::mutex> lock(_region_lock);
+
+	auto it = _region_ids.find(name);
+	if (it != _region_ids.end())
+		return it->second;
+
+	uint32_t id = (uint32_t)_region_names.size();
+	_region_names.emplace_back(name);
+	_region_ids.emplace(_region_names.back(), id);
+	return id;
+}
+
+std::string noice::source::scene_tracker::region_name(uint32_t id)
+{
+	std::unique_lock<std::mutex> lock(_region_lock);
+
+	if (id >= _region_names.size())
+		return std::string();
+	return _region_names[id];
+}
+
+void noice::source::scene_tracker::write_region_name(noice::util::json_writer &json, uint32_t id)
+{
+	std::unique_lock<std::mutex> lock(_region_lock);
+
+	json.value(id < _region_names.size() ? std::string_view(_region_names[id]) : std::string_view());
+}
+
+void noice::source::scene_tracker::occlusion_tick()
+{
+	noice::validation::occlusion_event event;
+	int64_t drained = 0;
+	while (_occlusion_events.pop(event)) {
+		_occlusions.apply(event);
+		_occlusion_stats.apply(event);
+		drained++;
+	}
+	noice::util::trace::counter("occlusion_events", drained);
+
+	if (!needs_diagnostics(diagnostics_type::hit_source_names))
+		return;
+
+	_occlusions.collect(_diagnostics_collecting.occlusions);
+	_diagnostics_collecting.stats_observed =
+		_occlusion_stats.summarize(obs_get_video_frame_time(), _diagnostics_collecting.stats, OCCLUSION_STATS_LIMIT);
+	_diagnostics_requests.fetch_and(~(1u << (uint32_t)diagnostics_type::hit_source_names));
+}
+
+void noice::source::scene_tracker::publish_occlusion_stats()
+{
+	uint64_t now = obs_get_video_frame_time();
+
+	// Statistics cover the current stream, or everything since the last one ended
+	bool streaming = noice::configuration::instance()->streaming_active();
+	if (streaming && !_occlusion_stats_streaming)
+		_occlusion_stats.reset(now);
+	_occlusion_stats_streaming = streaming;
+
+	std::vector<noice::validation::occlusion_summary> stats;
+	uint64_t observed = _occlusion_stats.summarize(now, stats, OCCLUSION_STATS_LIMIT);
+
+	std::unique_lock<std::mutex> lock(_published_stats_lock);
+	_published_stats.swap(stats);
+	_published_stats_observed = observed;
+}
+
+void noice::source::scene_tracker::resolve_occlusion_stats(const std::vector<noice::validation::occlusion_summary> &stats,
+							   std::vector<occlusion_stat> &out)
+{
+	auto classifier = noice::source::source_classifier::instance();
+	for (const noice::validation::occlusion_summary &summary : stats) {
+		std::string source_name = classifier ? classifier->source_name(summary.source_id) : std::string();
+		if (source_name.empty())
+			continue;
+
+		out.push_back({source_name, region_name(summary.region_id), summary.total / 1000000, summary.longest / 1000000,
+			       summary.fraction, summary.active});
+	}
+}
+
+std::vector<noice::source::occlusion_stat> noice::source::scene_tracker::get_occlusion_stats(uint64_t &observed_ms)
 {
-	std::unique_lock<std::mutex> lock(_diagnostics_lock);
+	std::vector<noice::validation::occlusion_summary> stats;
+	{
+		std::unique_lock<std::mutex> lock(_published_stats_lock);
+		stats = _published_stats;
+		observed_ms = _published_stats_observed / 1000000;
+	}
 
-	_hit_source_names = std::move(names);
-	_waiting_diagnostics[diagnostics_type::hit_source_names] = false;
+	std::vector<occlusion_stat> out;
+	resolve_occlusion_stats(stats, out);
+	return out;
 }
 
 void noice::source::scene_tracker::send_diagnostics(void *param)
 {
+	NOICE_TRACE_SCOPE("send_diagnostics");
 	noice::source::scene_tracker *st = reinterpret_cast<noice::source::scene_tracker *>(param);
 
+	diagnostics_report report;
+	bool has_report = st->_diagnostics_reports.pop(report);
+	st->_queued_diagnostics = false;
+
+	// Scene changed or a new round started in the meantime
+	if (!has_report || report.generation != st->_diagnostics_generation.load())
+		return;
+
 	auto auth = noice::auth::instance();
 	auto access_token = auth->get_access_token();
 
@@ -329,43 +463,97 @@ void noice::source::scene_tracker::send_diagnostics(void *param)
 		return;
 	}
 
-	std::ostringstream auth_header;
-	auth_header << "Bearer " << (*access_token);
+	std::string auth_header = "Bearer " + *access_token;
+
+	bool missingValidator = report.missing_validator;
 
-	std::unique_lock<std::mutex> lock(st->_diagnostics_lock);
-
-	bool missingValidator = !st->current_scene_has_noice_validator();
-
-	std::vector<std::string> hit_item_source_names = std::move(st->_hit_source_names);
-
-	nlohmann::json payload = {
-		{"event",
-		 {
-			 {"obsPluginInfo",
-			  {
-				  {"obsVersion", obs_get_version_string()},
-				  {"pluginVersion", PROJECT_VERSION},
-			  }},
-			 {"obsNoiceValidator",
-			  {
-				  {"missingValidator", missingValidator},
-				  {"occludingSourceNames", hit_item_source_names},
-			  }},
-		 }},
+	// Names are resolved here rather than on the graphics thread and written into the reused
+	// buffer straight from the classifier and region table, the body itself only allocates
+	// when it outgrows the buffer. The token, endpoint and curl request still allocate.
+	auto classifier = noice::source::source_classifier::instance();
+	uint64_t now = obs_get_video_frame_time();
+	std::vector<uint32_t> &hit_source_ids = st->_diagnostics_source_ids;
+	hit_source_ids.clear();
+
+	auto begin_entry = [](void *param, std::string_view name) {
+		noice::util::json_writer *json = reinterpret_cast<noice::util::json_writer *>(param);
+		json->begin_object();
+		json->member("sourceName", name);
 	};
 
-	lock.unlock();
+	noice::util::json_writer json(st->_diagnostics_body);
+	json.begin_object().key("event").begin_object();
+
+	json.key("obsPluginInfo").begin_object();
+	json.member("obsVersion", obs_get_version_string());
+	json.member("pluginVersion", PROJECT_VERSION);
+#if NOICE_PROFILER
+	// Plugin cost since load, microseconds
+	json.key("timings").begin_object();
+	for (uint32_t i = 0; i < (uint32_t)noice::util::profiler::probe::count; i++) {
+		auto probe = (noice::util::profiler::probe)i;
+		noice::util::profiler::summary summary = noice::util::profiler::query(probe);
+		if (summary.count == 0)
+			continue;
+		json.key(noice::util::profiler::probe_name(probe)).begin_object();
+		json.member("count", summary.count);
+		json.member("p50", summary.p50 / 1000.0);
+		json.member("p95", summary.p95 / 1000.0);
+		json.member("p99", summary.p99 / 1000.0);
+		json.member("max", summary.max / 1000.0);
+		json.end_object();
+	}
+	json.end_object();
+#endif
+	json.end_object();
 
-	std::ostringstream response_stream;
+	json.key("obsNoiceValidator").begin_object();
+	json.member("missingValidator", missingValidator);
 
-	auto cb = [&response_stream](void *data, size_t size, size_t nmemb) -> size_t {
-		const char *res = reinterpret_cast<char *>(data);
-		response_stream.write(res, size * nmemb);
+	json.key("occlusions").begin_array();
+	for (const noice::validation::occlusion_interval &interval : report.occlusions) {
+		if (!classifier || !classifier->visit_source_name(interval.source_id, begin_entry, &json))
+			continue;
 
-		return size * nmemb;
-	};
+		if (std::find(hit_source_ids.begin(), hit_source_ids.end(), interval.source_id) == hit_source_ids.end())
+			hit_source_ids.push_back(interval.source_id);
 
-	std::string json = payload.dump();
+		uint64_t end = interval.end ? interval.end : now;
+		json.key("region");
+		st->write_region_name(json, interval.region_id);
+		json.member("durationMs", end > interval.start ? (end - interval.start) / 1000000 : 0);
+		json.member("active", interval.end == 0);
+		json.end_object();
+	}
+	json.end_array();
+
+	json.key("occludingSourceNames").begin_array();
+	for (uint32_t source_id : hit_source_ids) {
+		auto value = [](void *param, std::string_view name) { reinterpret_cast<noice::util::json_writer *>(param)->value(name); };
+		classifier->visit_source_name(source_id, value, &json);
+	}
+	json.end_array();
+
+	json.key("occlusionStats").begin_object();
+	json.member("observedMs", report.stats_observed / 1000000);
+	json.key("entries").begin_array();
+	for (const noice::validation::occlusion_summary &summary : report.stats) {
+		if (!classifier || !classifier->visit_source_name(summary.source_id, begin_entry, &json))
+			continue;
+
+		json.key("region");
+		st->write_region_name(json, summary.region_id);
+		json.member("totalMs", summary.total / 1000000);
+		json.member("longestMs", summary.longest / 1000000);
+		json.member("fraction", summary.fraction);
+		json.member("active", summary.active);
+		json.end_object();
+	}
+	json.end_array();
+	json.end_object();
+
+	json.end_object();
+	json.end_object().end_object();
 
 	std::string endpoint = noice::get_api_endpoint("v1/streamer/diagnostics");
 
@@ -373,17 +561,14 @@ void noice::source::scene_tracker::send_diagnostics(void *param)
 	c.set_option(CURLOPT_URL, endpoint);
 	c.set_option(CURLOPT_POST, true);
 	c.set_header("Content-Type", "application/json");
-	c.set_header("Authorization", auth_header.str());
-	c.set_option(CURLOPT_POSTFIELDS, json.c_str());
-	c.set_write_callback(cb);
+	c.set_header("Authorization", auth_header);
+	c.set_option(CURLOPT_POSTFIELDSIZE, (long)json.str().size());
+	c.set_option(CURLOPT_POSTFIELDS, json.str().c_str());
+	noice::util::curl_response response;
+	c.set_response(response);
 
 	CURLcode code = c.perform();
 
-	lock.lock();
-	st->_queued_diagnostics = false;
-	st->clear_diagnostics();
-	lock.unlock();
-
 	if (code != CURLE_OK) {
 		DLOG_WARNING("diagnostics request failed.");
 		return;
@@ -393,23 +578,23 @@ void noice::source::scene_tracker::send_diagnostics(void *param)
 	c.get_info(CURLINFO_RESPONSE_CODE, response_code);
 
 	if (response_code != 200) {
-		DLOG_WARNING("diagnostics request failed with code: %ld, response: %s", response_code, response_stream.str().c_str());
+		DLOG_WARNING("diagnostics request failed with code: %ld, response: %.*s", response_code, (int)response.size(),
+			     response.data());
 		return;
 	}
 }
 
 bool noice::source::scene_tracker::needs_diagnostics(diagnostics_type type)
 {
-	std::unique_lock<std::mutex> lock(_diagnostics_lock);
-
-	auto it = _waiting_diagnostics.find(type);
-
-	return it != _waiting_diagnostics.end() && it->second;
+	return (_diagnostics_requests.load(std::memory_order_acquire) & (1u << (uint32_t)type)) != 0;
 }
 
 void noice::source::scene_tracker::clear_diagnostics()
 {
-	_waiting_diagnostics.clear();
+	// Invalidates whatever is collected or already handed over
+	_diagnostics_requests = 0;
+	_diagnostics_generation++;
+	_diagnostics_collecting = diagnostics_report();
 }
 
 void noice::source::scene_tracker::diagnostics_tick()
@@ -422,15 +607,16 @@ void noice::source::scene_tracker::diagnostics_tick()
 
 	auto cfg = noice::configuration::instance();
 
-	std::unique_lock<std::mutex> lock(_diagnostics_lock);
-
 	clear_diagnostics();
 
 	if (!cfg->streaming_active() || !cfg->noice_service_selected()) {
+		// Nobody is going to collect these
+		_occlusions.clear_closed();
 		return;
 	}
 
-	_waiting_diagnostics[diagnostics_type::hit_source_names] = true;
+	_diagnostics_collecting.generation = _diagnostics_generation.load();
+	_diagnostics_requests = 1u << (uint32_t)diagnostics_type::hit_source_names;
 }
 
 void noice::source::scene_tracker::update_selected_game_tick()
@@ -452,39 +638,20 @@ void noice::source::scene_tracker::update_selected_game_tick()
 
 void noice::source::scene_tracker::send_diagnostics_if_ready()
 {
-	std::unique_lock<std::mutex> lock(_diagnostics_lock);
-
-	if (_queued_diagnostics || _waiting_diagnostics.size() == 0) {
+	if (_queued_diagnostics || _diagnostics_collecting.generation == 0 || _diagnostics_requests.load() != 0) {
 		return;
 	}
 
-	for (const auto &pair : _waiting_diagnostics) {
-		if (pair.second) {
-			return;
-		}
+	_diagnostics_collecting.missing_validator = !current_scene_has_noice_validator();
+	if (!_diagnostics_reports.push(std::move(_diagnostics_collecting))) {
+		return;
 	}
+	_diagnostics_collecting = diagnostics_report();
 
 	_queued_diagnostics = true;
 	queue_task(send_diagnostics, this, false, _diagnostics_task_queue);
 }
 
-bool noice::source::scene_tracker::update_selected_game_enum_item(obs_scene_t *scene, obs_sceneitem_t *item, void *param)
-{
-	noice::source::scene_tracker *st = reinterpret_cast<noice::source::scene_tracker *>(param);
-
-	obs_source_t *src = obs_sceneitem_get_source(item);
-	const char *src_id = obs_source_get_id(src);
-
-	if (!strcmp(src_id, "noice_validator")) {
-		obs_data_t *data = obs_source_get_settings(src);
-		obs_data_set_string(data, "game", st->_fetched_selected_game.c_str());
-		obs_source_update(src, data);
-		obs_data_release(data);
-	}
-
-	return true;
-}
-
 void noice::source::scene_tracker::update_selected_game()
 {
 	DLOG_INFO("updating selected game, %s", _fetched_selected_game.c_str());
@@ -500,17 +667,23 @@ void noice::source::scene_tracker::update_selected_game()
 		return;
 	}
 
-	auto cb = [](void *param, obs_source_t *source) {
-		obs_scene_t *scene = obs_scene_from_source(source);
-		obs_scene_enum_items(scene, update_selected_game_enum_item, param);
+	auto registry = noice::source::validator_registry::instance();
+	if (!registry)
+		return;
 
-		return true;
-	};
-	obs_enum_scenes(cb, (void *)this);
+	size_t updated = 0;
+	for (obs_source_t *src : registry->validators()) {
+		auto instance = reinterpret_cast<noice::source::validator_instance *>(obs_obj_get_data(src));
+		if (instance && instance->set_game(_fetched_selected_game))
+			updated++;
+		obs_source_release(src);
+	}
+	DLOG_INFO("selected game applied to %zu validators", updated);
 }
 
 void noice::source::scene_tracker::fetch_selected_game(void *param)
 {
+	NOICE_TRACE_SCOPE("fetch_selected_game");
 	noice::source::scene_tracker *st = reinterpret_cast<noice::source::scene_tracker *>(param);
 
 	std::unique_lock<std::mutex> lock(st->_selected_game_lock);
@@ -532,18 +705,11 @@ void noice::source::scene_tracker::fetch_selected_game(void *param)
 
 	std::string endpoint = noice::get_api_endpoint("v1/streamer/selected_game");
 
-	std::ostringstream response_stream;
-	auto write_cb = [&response_stream](void *data, size_t size, size_t nmemb) -> size_t {
-		const char *res = reinterpret_cast<char *>(data);
-		response_stream.write(res, size * nmemb);
-
-		return size * nmemb;
-	};
-
+	noice::util::curl_response response;
 	noice::util::curl c;
 	c.set_option(CURLOPT_URL, endpoint);
 	c.set_header("Authorization", auth_header.str());
-	c.set_write_callback(write_cb);
+	c.set_response(response);
 
 	CURLcode code = c.perform();
 	if (code != CURLE_OK) {
@@ -555,14 +721,15 @@ void noice::source::scene_tracker::fetch_selected_game(void *param)
 	c.get_info(CURLINFO_RESPONSE_CODE, response_code);
 
 	if (response_code != 200) {
-		DLOG_WARNING("get selected game request failed with response code: %ld %s", response_code, response_stream.str().c_str());
+		DLOG_WARNING("get selected game request failed with response code: %ld %.*s", response_code, (int)response.size(),
+			     response.data());
 		return;
 	}
 
 	nlohmann::json selected_game_response;
 
 	try {
-		selected_game_response = nlohmann::json::parse(response_stream.str());
+		selected_game_response = nlohmann::json::parse(response.view());
 	} catch (...) {
 		DLOG_WARNING("failed to parse response for get selected game request");
 		return;
@@ -741,6 +908,7 @@ typedef struct obs_scene31 obs_scene31_t;
 // frontend library and is not accurate for all use cases (Multiview etc)
 void noice::source::scene_tracker::probe_current_enum_scene_source()
 {
+	NOICE_TRACE_SCOPE("probe_current_enum_scene");
 	std::unique_lock<std::mutex> lock(_lock);
 	uint32_t version = obs_get_version();
 	bool found = false;
@@ -785,6 +953,38 @@ void noice::source::scene_tracker::probe_current_enum_scene_source()
 	}
 }
 
+void noice::source::scene_tracker::queue_worker_task(os_task_t task, void *param)
+{
+	queue_task(task, param, false, _worker_task_queue);
+}
+
+bool noice::source::scene_tracker::record_scene(noice::validation::scene_recording &recording)
+{
+	struct obs_video_info ovi = {};
+	if (!obs_get_video_info(&ovi))
+		return false;
+
+	recording.video = {ovi.base_width, ovi.base_height, ovi.output_width, ovi.output_height, ovi.fps_num, ovi.fps_den};
+
+	auto registry = noice::source::validator_registry::instance();
+	if (registry) {
+		for (obs_source_t *src : registry->validators()) {
+			auto instance = reinterpret_cast<noice::source::validator_instance *>(obs_obj_get_data(src));
+			auto result = instance ? instance->latest_result() : nullptr;
+			if (recording.regions.empty() && result && result->regions)
+				recording.regions = *result->regions;
+			obs_source_release(src);
+		}
+	}
+
+	obs_source_t *source = obs_weak_source_get_source(get_current_enum_scene());
+	obs_scene_t *scene = obs_scene_from_source(source);
+	bool recorded = scene && record_scene_frame(scene, recording);
+	obs_source_release(source);
+
+	return recorded;
+}
+
 obs_weak_source_t *noice::source::scene_tracker::get_current_enum_scene()
 {
 	queue_task(
@@ -796,6 +996,13 @@ obs_weak_source_t *noice::source::scene_tracker::get_current_enum_scene()
 	return _current_enum_scene;
 }
 
+void noice::source::scene_tracker::start_scenecollection_watch()
+{
+	auto cfg = noice::configuration::instance();
+	if (cfg && cfg->is_slobs())
+		scenecollection_watch();
+}
+
 void noice::source::scene_tracker::scenecollection_watch()
 {
 	if (!_dmon_initialized) {
@@ -850,44 +1057,18 @@ void noice::source::scene_tracker::scenecollection_update()
 
 bool noice::source::scene_tracker::scenecollection_parse(std::istream &input)
 {
-	std::map<std::string, std::string> guid2source;
-	std::map<std::string, std::string> source2guid;
-
-	try {
-		nlohmann::json data;
-		data = nlohmann::json::parse(input);
-
-		nlohmann::json obj = data["sources"];
-		for (auto items_it : obj["items"]) {
-			auto item_obj = items_it.get<nlohmann::json::object_t>();
-			std::string guid = item_obj["id"].get<std::string>();
-			std::string name = item_obj["name"].get<std::string>();
-
-			guid2source[guid] = name;
-			source2guid[name] = guid;
-		}
-
-		obj = data["scenes"];
-		for (auto items_it : obj["items"]) {
-			auto item_obj = items_it.get<nlohmann::json::object_t>();
-			std::string guid = item_obj["id"].get<std::string>();
-			std::string name = item_obj["name"].get<std::string>();
-
-			guid2source[guid] = name;
-			source2guid[name] = guid;
-		}
-	} catch (std::exception const &ex) {
-		DLOG_ERROR("JSON parse error: %s", ex.what());
+	scenecollection_names names;
+	if (!parse_scenecollection(input, names))
 		return false;
-	}
 
-	_sc_collection_changed = guid2source != _sc_guid2source;
+	_sc_collection_changed = names.guid2source != _sc_guid2source;
 	if (_sc_collection_changed) {
-		_sc_guid2source = guid2source;
-		_sc_source2guid = source2guid;
+		_sc_guid2source = std::move(names.guid2source);
+		_sc_source2guid = std::move(names.source2guid);
 
-		for (const auto &p : guid2source) {
-			DLOG_INFO("guid: %s source: %s", p.first.c_str(), p.second.c_str());
+		DLOG_INFO("scene collection changed, %zu sources", _sc_guid2source.size());
+		for (const auto &p : _sc_guid2source) {
+			DLOG_DEBUG("guid: %s source: %s", p.first.c_str(), p.second.c_str());
 		}
 	}
 
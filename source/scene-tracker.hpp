@@ -14,6 +14,7 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #pragma once
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -22,6 +23,10 @@
 #include <util/task.h>
 #include <util/threading.h>
 #include <obs-scene.h>
+#include "scene-recording.hpp"
+#include "validation.hpp"
+#include "util/util-json.hpp"
+#include "util/util-ring.hpp"
 
 #define ENABLE_SINGLETON_SOURCE 0
 
@@ -31,6 +36,28 @@ enum class diagnostics_type {
 	hit_source_names,
 };
 
+// Everything collected for one diagnostics round, handed from the graphics thread to the
+// diagnostics thread
+struct diagnostics_report {
+	uint64_t generation;
+	bool missing_validator;
+	std::vector<noice::validation::occlusion_interval> occlusions;
+	std::vector<noice::validation::occlusion_summary> stats;
+	uint64_t stats_observed;
+
+	diagnostics_report() : generation(0), missing_validator(false), stats_observed(0) {}
+};
+
+// Occlusion statistics with names resolved, for display
+struct occlusion_stat {
+	std::string source_name;
+	std::string region;
+	uint64_t total_ms;
+	uint64_t longest_ms;
+	float fraction;
+	bool active;
+};
+
 class scene_tracker {
 private:
 	float _time_elapsed;
@@ -53,6 +80,7 @@ private:
 
 	os_task_queue_t *_task_queue;
 	os_task_queue_t *_diagnostics_task_queue;
+	os_task_queue_t *_worker_task_queue;
 	std::vector<std::shared_ptr<obs_weak_source_t>> _current_tick_scenes;
 	std::mutex _lock;
 
@@ -64,11 +92,33 @@ private:
 
 	bool _dmon_initialized;
 
-	std::vector<std::string> _hit_source_names;
-	bool _current_scene_has_noice_validator;
-	std::map<diagnostics_type, bool> _waiting_diagnostics;
-	bool _queued_diagnostics;
-	std::mutex _diagnostics_lock;
+	// Produced by the validation engines on the worker thread, consumed in tick_handler
+	noice::util::spsc_ring<noice::validation::occlusion_event> _occlusion_events;
+	noice::validation::occlusion_intervals _occlusions;
+	// Since the last stream start, only touched from tick_handler
+	noice::validation::occlusion_stats _occlusion_stats;
+	bool _occlusion_stats_streaming;
+	// Latest summary for the UI
+	std::vector<noice::validation::occlusion_summary> _published_stats;
+	uint64_t _published_stats_observed;
+	std::mutex _published_stats_lock;
+
+	std::map<std::string, uint32_t, std::less<>> _region_ids;
+	std::vector<std::string> _region_names;
+	std::mutex _region_lock;
+
+	std::atomic<bool> _current_scene_has_noice_validator;
+	// Bit per diagnostics_type still to be collected in the current round
+	std::atomic<uint32_t> _diagnostics_requests;
+	// Current round, reports from older rounds are dropped
+	std::atomic<uint64_t> _diagnostics_generation;
+	// Round being collected, only touched from tick_handler
+	diagnostics_report _diagnostics_collecting;
+	noice::util::spsc_ring<diagnostics_report> _diagnostics_reports;
+	std::atomic<bool> _queued_diagnostics;
+	// Request body and scratch, reused by send_diagnostics on the diagnostics queue
+	std::string _diagnostics_body;
+	std::vector<uint32_t> _diagnostics_source_ids;
 
 	std::mutex _selected_game_lock;
 	std::string _fetched_selected_game;
@@ -83,7 +133,6 @@ private:
 	static void obs_tick_handler(void *private_data, float seconds);
 	static void send_diagnostics(void *param);
 	static void fetch_selected_game(void *param);
-	static bool update_selected_game_enum_item(obs_scene_t *scene, obs_sceneitem_t *item, void *param);
 
 	void tick_handler();
 
@@ -109,6 +158,15 @@ private:
 
 	void diagnostics_tick();
 
+	void occlusion_tick();
+
+	void publish_occlusion_stats();
+
+	void resolve_occlusion_stats(const std::vector<noice::validation::occlusion_summary> &stats, std::vector<occlusion_stat> &out);
+
+	// Writes the region name as a JSON value without copying it, empty when unknown
+	void write_region_name(noice::util::json_writer &json, uint32_t id);
+
 	void set_current_scene_has_noice_validator(bool has);
 
 	bool current_scene_has_noice_validator();
@@ -132,12 +190,31 @@ public:
 
 	virtual bool has_finished_loading() { return _has_finished_loading; };
 
-	virtual void add_hit_item_source_names(std::vector<std::string> &names);
+	// Called by the validation engines only, one at a time
+	virtual bool push_occlusion_event(const noice::validation::occlusion_event &event);
+
+	virtual uint32_t intern_region(std::string_view name);
+
+	virtual std::string region_name(uint32_t id);
+
+	// Occlusion statistics as of the last scene check, observed_ms is the time they cover
+	virtual std::vector<occlusion_stat> get_occlusion_stats(uint64_t &observed_ms);
 
 	virtual bool needs_diagnostics(diagnostics_type type);
 
 	virtual void trigger_fetch_selected_game();
 
+	// Watches the active scene collection for source names, SLOBS only. Run by the
+	// startup lane since the first parse reads the whole collection.
+	virtual void start_scenecollection_watch();
+
+	// Queue computation off the graphics thread, tasks own their parameters
+	virtual void queue_worker_task(os_task_t task, void *param);
+
+	// Canvas and current enum scene, with the regions of the first validator that has
+	// validated something. Fails when there is no enum scene yet or no frame could be recorded.
+	virtual bool record_scene(noice::validation::scene_recording &recording);
+
 private /* Singleton */:
 	static std::shared_ptr<noice::source::scene_tracker> _instance;
 
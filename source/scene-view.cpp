@@ -0,0 +1,340 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "scene-view.hpp"
+#include "source-classifier.hpp"
+#include "common.hpp"
+#include <obs-module.h>
+
+// Scene signals that change the flattened view. Source size changes go through the item
+// transform update in libobs and are reported as item_transform.
+static const char *scene_change_signals[] = {
+	"item_add", "item_remove", "reorder", "refresh", "item_visible", "item_transform",
+};
+
+#pragma mark Utilities from OBS at UI/window-basic-preview.cpp
+
+static bool SceneItemHasVideo(obs_sceneitem_t *item)
+{
+	obs_source_t *source = obs_sceneitem_get_source(item);
+	uint32_t flags = obs_source_get_output_flags(source);
+	return (flags & OBS_SOURCE_VIDEO) != 0;
+}
+
+static vec2 GetItemSize(obs_sceneitem_t *item)
+{
+	obs_bounds_type boundsType = obs_sceneitem_get_bounds_type(item);
+	vec2 size;
+
+	if (boundsType != OBS_BOUNDS_NONE) {
+		obs_sceneitem_get_bounds(item, &size);
+	} else {
+		obs_source_t *source = obs_sceneitem_get_source(item);
+		obs_sceneitem_crop crop;
+		vec2 scale;
+
+		obs_sceneitem_get_scale(item, &scale);
+		obs_sceneitem_get_crop(item, &crop);
+		size.x = float(obs_source_get_width(source) - crop.left - crop.right) * scale.x;
+		size.y = float(obs_source_get_height(source) - crop.top - crop.bottom) * scale.y;
+	}
+
+	return size;
+}
+
+#pragma mark Flattening
+
+static noice::validation::transform to_transform(const matrix4 &m)
+{
+	return {{m.x.x, m.x.y}, {m.y.x, m.y.y}, {m.t.x, m.t.y}};
+}
+
+static int sceneitem_coverage(obs_sceneitem_t *item, uint32_t canvas_width, uint32_t canvas_height)
+{
+	vec2 pos;
+	obs_sceneitem_get_pos(item, &pos);
+	vec2 size = GetItemSize(item);
+	return noice::validation::canvas_coverage({pos.x, pos.y}, {size.x, size.y}, obs_sceneitem_get_rot(item), (float)canvas_width,
+						  (float)canvas_height);
+}
+
+static void fill_item(noice::validation::item &entry, noice::source::source_classifier &classifier, obs_sceneitem_t *item,
+		      const noice::validation::transform &parent_transform, uint32_t canvas_width, uint32_t canvas_height)
+{
+	matrix4 box_transform;
+	obs_sceneitem_get_box_transform(item, &box_transform);
+	entry.local_box_transform = to_transform(box_transform);
+	entry.parent_transform = parent_transform;
+	entry.box_transform = noice::validation::multiply(entry.local_box_transform, parent_transform);
+
+	vec2 box_scale;
+	obs_sceneitem_get_box_scale(item, &box_scale);
+	entry.box_scale = {box_scale.x, box_scale.y};
+
+	noice::source::source_class cls = classifier.classify(obs_sceneitem_get_source(item));
+	entry.source_id = cls.id;
+	entry.main_video = cls.main_video;
+	// Main video is skipped regardless of coverage
+	entry.coverage = entry.main_video ? 0 : classifier.coverage(item, canvas_width, canvas_height, sceneitem_coverage);
+}
+
+struct flatten_context {
+	noice::validation::scene_snapshot &view;
+	std::vector<obs_source_t *> &scenes;
+	noice::source::source_classifier &classifier;
+};
+
+static void flatten_item(flatten_context &ctx, obs_sceneitem_t *item, const noice::validation::transform &parent_transform);
+
+static void flatten_scene(flatten_context &ctx, obs_scene_t *scene, obs_sceneitem_t *group,
+			  const noice::validation::transform &parent_transform)
+{
+	ctx.scenes.push_back(obs_scene_get_source(scene));
+
+	struct enum_param {
+		flatten_context &ctx;
+		const noice::validation::transform &parent_transform;
+	} param{ctx, parent_transform};
+
+	auto enum_item = [](obs_scene_t *, obs_sceneitem_t *item, void *data) {
+		enum_param *p = reinterpret_cast<enum_param *>(data);
+		flatten_item(p->ctx, item, p->parent_transform);
+		return true;
+	};
+
+	if (group)
+		obs_sceneitem_group_enum_items(group, enum_item, &param);
+	else
+		obs_scene_enum_items(scene, enum_item, &param);
+}
+
+static void flatten_item(flatten_context &ctx, obs_sceneitem_t *item, const noice::validation::transform &parent_transform)
+{
+	if (!obs_sceneitem_visible(item))
+		return;
+
+	if (obs_sceneitem_is_group(item)) {
+		// Group draw transform is relative to the scene or group containing it
+		matrix4 mat;
+		obs_sceneitem_get_draw_transform(item, &mat);
+		noice::validation::transform group_transform = noice::validation::multiply(to_transform(mat), parent_transform);
+
+		// Do not validate/hilight the group itself, because the grouped items could be miles apart
+		flatten_scene(ctx, obs_sceneitem_group_get_scene(item), item, group_transform);
+		return;
+	}
+
+	if (!SceneItemHasVideo(item))
+		return;
+
+	noice::validation::item entry;
+	fill_item(entry, ctx.classifier, item, parent_transform, ctx.view.canvas_width, ctx.view.canvas_height);
+	ctx.view.items.push_back(std::move(entry));
+}
+
+#pragma mark Recording
+
+struct record_context {
+	noice::validation::scene_recording &recording;
+	noice::validation::recorded_frame &frame;
+	noice::source::source_classifier &classifier;
+};
+
+static void record_item(record_context &ctx, obs_sceneitem_t *item, const noice::validation::transform &parent_transform, bool visible);
+
+static void record_scene(record_context &ctx, obs_scene_t *scene, obs_sceneitem_t *group,
+			 const noice::validation::transform &parent_transform, bool visible)
+{
+	struct enum_param {
+		record_context &ctx;
+		const noice::validation::transform &parent_transform;
+		bool visible;
+	} param{ctx, parent_transform, visible};
+
+	auto enum_item = [](obs_scene_t *, obs_sceneitem_t *item, void *data) {
+		enum_param *p = reinterpret_cast<enum_param *>(data);
+		record_item(p->ctx, item, p->parent_transform, p->visible);
+		return true;
+	};
+
+	if (group)
+		obs_sceneitem_group_enum_items(group, enum_item, &param);
+	else
+		obs_scene_enum_items(scene, enum_item, &param);
+}
+
+// Same walk as flatten_item, but hidden and audio only items are kept and flagged
+static void record_item(record_context &ctx, obs_sceneitem_t *item, const noice::validation::transform &parent_transform, bool visible)
+{
+	visible = visible && obs_sceneitem_visible(item);
+
+	if (obs_sceneitem_is_group(item)) {
+		matrix4 mat;
+		obs_sceneitem_get_draw_transform(item, &mat);
+		noice::validation::transform group_transform = noice::validation::multiply(to_transform(mat), parent_transform);
+		record_scene(ctx, obs_sceneitem_group_get_scene(item), item, group_transform, visible);
+		return;
+	}
+
+	obs_source_t *source = obs_sceneitem_get_source(item);
+	const char *type = obs_source_get_id(source);
+
+	noice::validation::recorded_item entry;
+	fill_item(entry.entry, ctx.classifier, item, parent_transform, ctx.recording.video.base_width, ctx.recording.video.base_height);
+	entry.source_type = ctx.recording.intern_source_type(type ? type : "");
+	entry.source_width = obs_source_get_width(source);
+	entry.source_height = obs_source_get_height(source);
+	entry.visible = visible;
+	entry.video = SceneItemHasVideo(item);
+
+	ctx.frame.items.push_back(std::move(entry));
+}
+
+bool noice::source::record_scene_frame(obs_scene_t *scene, noice::validation::scene_recording &recording)
+{
+	auto classifier = source_classifier::instance();
+	if (!classifier)
+		return false;
+
+	recording.frames.emplace_back();
+	noice::validation::recorded_frame &frame = recording.frames.back();
+	frame.frame_time = obs_get_video_frame_time();
+
+	record_context ctx{recording, frame, *classifier};
+	record_scene(ctx, scene, nullptr, noice::validation::transform::identity(), true);
+	return true;
+}
+
+#pragma mark Cache
+
+noice::source::scene_view_cache::scene_view_cache() : _generation(1) {}
+
+noice::source::scene_view_cache::~scene_view_cache()
+{
+	std::vector<obs_source_t *> scenes;
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		scenes.assign(_connected.begin(), _connected.end());
+		_connected.clear();
+		_views.clear();
+	}
+
+	for (obs_source_t *scene : scenes)
+		disconnect_scene(scene);
+}
+
+void noice::source::scene_view_cache::scene_changed(void *param, calldata_t *)
+{
+	auto self = reinterpret_cast<noice::source::scene_view_cache *>(param);
+	self->_generation++;
+}
+
+void noice::source::scene_view_cache::scene_destroyed(void *param, calldata_t *data)
+{
+	auto self = reinterpret_cast<noice::source::scene_view_cache *>(param);
+	obs_source_t *scene = (obs_source_t *)calldata_ptr(data, "source");
+
+	self->_generation++;
+	std::unique_lock<std::mutex> lock(self->_lock);
+	self->_connected.erase(scene);
+	self->_views.erase(scene);
+}
+
+void noice::source::scene_view_cache::connect_scene(obs_source_t *scene)
+{
+	signal_handler_t *sh = obs_source_get_signal_handler(scene);
+	for (const char *signal : scene_change_signals)
+		signal_handler_connect(sh, signal, scene_changed, this);
+	signal_handler_connect(sh, "destroy", scene_destroyed, this);
+}
+
+void noice::source::scene_view_cache::disconnect_scene(obs_source_t *scene)
+{
+	signal_handler_t *sh = obs_source_get_signal_handler(scene);
+	for (const char *signal : scene_change_signals)
+		signal_handler_disconnect(sh, signal, scene_changed, this);
+	signal_handler_disconnect(sh, "destroy", scene_destroyed, this);
+}
+
+void noice::source::scene_view_cache::build(noice::validation::scene_snapshot &view, std::vector<obs_source_t *> &scenes, obs_scene_t *scene)
+{
+	auto classifier = source_classifier::instance();
+	flatten_context ctx{view, scenes, *classifier};
+	flatten_scene(ctx, scene, nullptr, noice::validation::transform::identity());
+}
+
+std::shared_ptr<const noice::validation::scene_snapshot> noice::source::scene_view_cache::get(obs_scene_t *scene, uint32_t canvas_width,
+											      uint32_t canvas_height)
+{
+	obs_source_t *scene_source = obs_scene_get_source(scene);
+	uint64_t generation = _generation.load();
+	size_t capacity = 0;
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		auto it = _views.find(scene_source);
+		if (it != _views.end()) {
+			const view_entry &entry = it->second;
+			if (entry.generation == generation && entry.view->canvas_width == canvas_width &&
+			    entry.view->canvas_height == canvas_height)
+				return entry.view;
+			capacity = entry.view->items.size();
+		}
+	}
+
+	auto view = std::make_shared<noice::validation::scene_snapshot>();
+	view->frame_time = obs_get_video_frame_time();
+	view->canvas_width = canvas_width;
+	view->canvas_height = canvas_height;
+	view->items.reserve(capacity);
+
+	std::vector<obs_source_t *> scenes;
+	build(*view, scenes, scene);
+
+	std::vector<obs_source_t *> connect;
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		for (obs_source_t *source : scenes) {
+			if (_connected.insert(source).second)
+				connect.push_back(source);
+		}
+	}
+	for (obs_source_t *source : connect)
+		connect_scene(source);
+
+	std::unique_lock<std::mutex> lock(_lock);
+	// Changes made before the signals got connected were missed, rebuild once more next time
+	_views[scene_source] = {view, connect.empty() ? generation : 0};
+	return view;
+}
+
+#pragma mark Singleton
+
+std::shared_ptr<noice::source::scene_view_cache> noice::source::scene_view_cache::_instance = nullptr;
+
+void noice::source::scene_view_cache::initialize()
+{
+	if (!noice::source::scene_view_cache::_instance)
+		noice::source::scene_view_cache::_instance = std::make_shared<noice::source::scene_view_cache>();
+}
+
+void noice::source::scene_view_cache::finalize()
+{
+	noice::source::scene_view_cache::_instance.reset();
+}
+
+std::shared_ptr<noice::source::scene_view_cache> noice::source::scene_view_cache::instance()
+{
+	return noice::source::scene_view_cache::_instance;
+}
@@ -0,0 +1,82 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <obs.h>
+#include "scene-recording.hpp"
+#include "validation.hpp"
+
+namespace noice::source {
+
+// Flattened views of scenes: visible video leaf items with group transforms composed
+// into world transforms, in draw order. A view is immutable and shared until the scene,
+// any group in it, or the canvas size changes, so validators can submit and draw it
+// every frame without walking the scene graph.
+class scene_view_cache {
+private:
+	struct view_entry {
+		std::shared_ptr<const noice::validation::scene_snapshot> view;
+		uint64_t generation;
+	};
+
+	std::mutex _lock;
+	std::unordered_map<obs_source_t *, view_entry> _views;
+	// Scenes and groups with connected change signals
+	std::unordered_set<obs_source_t *> _connected;
+
+	// Bumped by any change in a connected scene. Signal callbacks only touch this, scene
+	// signals can be emitted with the scene mutex held while a rebuild is enumerating.
+	std::atomic<uint64_t> _generation;
+
+public:
+	virtual ~scene_view_cache();
+	scene_view_cache();
+
+private:
+	static void scene_changed(void *param, calldata_t *data);
+	static void scene_destroyed(void *param, calldata_t *data);
+
+	void connect_scene(obs_source_t *scene);
+
+	void disconnect_scene(obs_source_t *scene);
+
+	void build(noice::validation::scene_snapshot &view, std::vector<obs_source_t *> &scenes, obs_scene_t *scene);
+
+public:
+	// Current view of the scene, rebuilt only when something changed since the last call
+	std::shared_ptr<const noice::validation::scene_snapshot> get(obs_scene_t *scene, uint32_t canvas_width, uint32_t canvas_height);
+
+private /* Singleton */:
+	static std::shared_ptr<noice::source::scene_view_cache> _instance;
+
+public /* Singleton */:
+	static void initialize();
+
+	static void finalize();
+
+	static std::shared_ptr<noice::source::scene_view_cache> instance();
+};
+
+// Appends the scene as it is now to the recording, hidden and audio only items included.
+// Canvas coverage is computed against the recording's base resolution. False when no frame
+// was added, the plugin is shutting down.
+bool record_scene_frame(obs_scene_t *scene, noice::validation::scene_recording &recording);
+} // namespace noice::source
@@ -0,0 +1,286 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "source-classifier.hpp"
+#include "common.hpp"
+#include <obs-module.h>
+
+// Sources showing the game itself, these are never validated against the regions
+static constexpr std::string_view main_video_source_ids[] = {
+	"noice_validator",
+	// Win
+	"monitor_capture",
+	"game_capture",
+	// Mac
+	"display_capture",
+	// Win & Mac
+	"window_capture",
+	// Linux
+	"pipewire-desktop-capture-source",
+	"pipewire-window-capture-source",
+	"xcomposite_input",
+	"xshm_input",
+};
+
+noice::source::source_classifier::source_classifier() : _next_source_id(1), _transform_epoch(0)
+{
+	// Unknown / invalid sources share id 0
+	intern_type("");
+}
+
+noice::source::source_classifier::~source_classifier()
+{
+	std::vector<obs_source_t *> sources, scenes;
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		for (auto &it : _sources)
+			sources.push_back(it.first);
+		scenes.assign(_scenes.begin(), _scenes.end());
+		_sources.clear();
+		_source_ids.clear();
+		_scenes.clear();
+		_items.clear();
+	}
+
+	for (obs_source_t *source : sources)
+		disconnect_source(source);
+	for (obs_source_t *scene : scenes)
+		disconnect_scene(scene);
+}
+
+#pragma mark Signals
+
+void noice::source::source_classifier::source_updated(void *param, calldata_t *data)
+{
+	auto self = reinterpret_cast<noice::source::source_classifier *>(param);
+	obs_source_t *source = (obs_source_t *)calldata_ptr(data, "source");
+
+	std::unique_lock<std::mutex> lock(self->_lock);
+	auto it = self->_sources.find(source);
+	if (it != self->_sources.end())
+		it->second.valid = false;
+}
+
+void noice::source::source_classifier::source_destroyed(void *param, calldata_t *data)
+{
+	auto self = reinterpret_cast<noice::source::source_classifier *>(param);
+	obs_source_t *source = (obs_source_t *)calldata_ptr(data, "source");
+
+	std::unique_lock<std::mutex> lock(self->_lock);
+	auto it = self->_sources.find(source);
+	if (it == self->_sources.end())
+		return;
+	self->_source_ids.erase(it->second.cls.id);
+	self->_sources.erase(it);
+}
+
+void noice::source::source_classifier::scene_item_transform(void *param, calldata_t *data)
+{
+	auto self = reinterpret_cast<noice::source::source_classifier *>(param);
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(data, "item");
+
+	std::unique_lock<std::mutex> lock(self->_lock);
+	self->_transform_epoch++;
+	auto it = self->_items.find(item);
+	if (it != self->_items.end())
+		it->second.valid = false;
+}
+
+void noice::source::source_classifier::scene_item_remove(void *param, calldata_t *data)
+{
+	auto self = reinterpret_cast<noice::source::source_classifier *>(param);
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(data, "item");
+
+	std::unique_lock<std::mutex> lock(self->_lock);
+	self->_items.erase(item);
+}
+
+void noice::source::source_classifier::scene_destroyed(void *param, calldata_t *data)
+{
+	auto self = reinterpret_cast<noice::source::source_classifier *>(param);
+	obs_source_t *scene = (obs_source_t *)calldata_ptr(data, "source");
+
+	std::unique_lock<std::mutex> lock(self->_lock);
+	self->_scenes.erase(scene);
+	for (auto it = self->_items.begin(); it != self->_items.end();) {
+		if (it->second.scene == scene)
+			it = self->_items.erase(it);
+		else
+			++it;
+	}
+}
+
+void noice::source::source_classifier::connect_source(obs_source_t *source)
+{
+	signal_handler_t *sh = obs_source_get_signal_handler(source);
+	signal_handler_connect(sh, "update", source_updated, this);
+	signal_handler_connect(sh, "destroy", source_destroyed, this);
+}
+
+void noice::source::source_classifier::disconnect_source(obs_source_t *source)
+{
+	signal_handler_t *sh = obs_source_get_signal_handler(source);
+	signal_handler_disconnect(sh, "update", source_updated, this);
+	signal_handler_disconnect(sh, "destroy", source_destroyed, this);
+}
+
+void noice::source::source_classifier::connect_scene(obs_source_t *scene)
+{
+	signal_handler_t *sh = obs_source_get_signal_handler(scene);
+	signal_handler_connect(sh, "item_transform", scene_item_transform, this);
+	signal_handler_connect(sh, "item_remove", scene_item_remove, this);
+	signal_handler_connect(sh, "destroy", scene_destroyed, this);
+}
+
+void noice::source::source_classifier::disconnect_scene(obs_source_t *scene)
+{
+	signal_handler_t *sh = obs_source_get_signal_handler(scene);
+	signal_handler_disconnect(sh, "item_transform", scene_item_transform, this);
+	signal_handler_disconnect(sh, "item_remove", scene_item_remove, this);
+	signal_handler_disconnect(sh, "destroy", scene_destroyed, this);
+}
+
+#pragma mark Classification
+
+noice::source::source_type_id noice::source::source_classifier::intern_type(const char *id)
+{
+	std::string_view key = id ? id : "";
+
+	auto it = _type_ids.find(key);
+	if (it != _type_ids.end())
+		return it->second;
+
+	bool main_video = false;
+	for (std::string_view main_video_id : main_video_source_ids)
+		main_video |= key == main_video_id;
+
+	source_type_id type = (source_type_id)_type_names.size();
+	_type_names.emplace_back(key);
+	_type_main_video.push_back(main_video);
+	_type_ids[_type_names.back()] = type;
+	return type;
+}
+
+noice::source::source_class noice::source::source_classifier::classify(obs_source_t *source)
+{
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		auto it = _sources.find(source);
+		if (it != _sources.end() && it->second.valid)
+			return it->second.cls;
+	}
+
+	// Connect before classifying so an update racing with us invalidates the fresh entry
+	connect_source(source);
+
+	std::unique_lock<std::mutex> lock(_lock);
+	source_entry &entry = _sources[source];
+	if (entry.cls.id == 0) {
+		entry.cls.id = _next_source_id++;
+		_source_ids[entry.cls.id] = source;
+	}
+	entry.cls.type = intern_type(obs_source_get_unversioned_id(source));
+	entry.cls.main_video = _type_main_video[entry.cls.type];
+	entry.valid = true;
+	return entry.cls;
+}
+
+int noice::source::source_classifier::coverage(obs_sceneitem_t *item, uint32_t canvas_width, uint32_t canvas_height,
+					       coverage_func_t compute)
+{
+	obs_source_t *source = obs_sceneitem_get_source(item);
+	uint32_t source_width = obs_source_get_width(source);
+	uint32_t source_height = obs_source_get_height(source);
+
+	uint64_t epoch;
+	bool known;
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		auto it = _items.find(item);
+		known = it != _items.end();
+		if (known) {
+			const item_entry &entry = it->second;
+			if (entry.valid && entry.source_width == source_width && entry.source_height == source_height &&
+			    entry.canvas_width == canvas_width && entry.canvas_height == canvas_height)
+				return entry.coverage;
+		}
+		epoch = _transform_epoch;
+	}
+
+	obs_source_t *scene = obs_scene_get_source(obs_sceneitem_get_scene(item));
+	if (!known)
+		connect_scene(scene);
+
+	int coverage = compute(item, canvas_width, canvas_height);
+
+	std::unique_lock<std::mutex> lock(_lock);
+	_scenes.insert(scene);
+	// A transform changed while computing, keep the value for this frame only
+	bool valid = epoch == _transform_epoch;
+	_items[item] = {scene, source, valid, source_width, source_height, canvas_width, canvas_height, coverage};
+	return coverage;
+}
+
+std::string noice::source::source_classifier::type_name(source_type_id type)
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	if (type >= _type_names.size())
+		return std::string();
+	return _type_names[type];
+}
+
+std::string noice::source::source_classifier::source_name(uint32_t id)
+{
+	// Destroyed sources are dropped under the lock before libobs frees them
+	std::unique_lock<std::mutex> lock(_lock);
+	auto it = _source_ids.find(id);
+	if (it == _source_ids.end())
+		return std::string();
+	const char *name = obs_source_get_name(it->second);
+	return name ? name : "";
+}
+
+bool noice::source::source_classifier::visit_source_name(uint32_t id, void (*proc)(void *param, std::string_view name), void *param)
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	auto it = _source_ids.find(id);
+	if (it == _source_ids.end())
+		return false;
+	const char *name = obs_source_get_name(it->second);
+	if (!name || !*name)
+		return false;
+	proc(param, name);
+	return true;
+}
+
+#pragma mark Singleton
+
+std::shared_ptr<noice::source::source_classifier> noice::source::source_classifier::_instance = nullptr;
+
+void noice::source::source_classifier::initialize()
+{
+	if (!noice::source::source_classifier::_instance)
+		noice::source::source_classifier::_instance = std::make_shared<noice::source::source_classifier>();
+}
+
+void noice::source::source_classifier::finalize()
+{
+	noice::source::source_classifier::_instance.reset();
+}
+
+std::shared_ptr<noice::source::source_classifier> noice::source::source_classifier::instance()
+{
+	return noice::source::source_classifier::_instance;
+}
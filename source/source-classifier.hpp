@@ -0,0 +1,128 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <cinttypes>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <obs.h>
+
+namespace noice::source {
+
+// Interned unversioned source type id, stable until the plugin is unloaded
+typedef uint16_t source_type_id;
+
+struct source_class {
+	// Unique per source for the lifetime of the plugin, never reused
+	uint32_t id;
+	source_type_id type;
+	bool main_video;
+};
+
+// Per source classification and per item canvas coverage, cached so validation can
+// filter items every frame without string building or map lookups on type names.
+// Entries are invalidated by source update/destroy and scene item_transform/item_remove
+// signals, canvas and source size changes are picked up on lookup.
+class source_classifier {
+public:
+	typedef int (*coverage_func_t)(obs_sceneitem_t *item, uint32_t canvas_width, uint32_t canvas_height);
+
+private:
+	struct source_entry {
+		source_class cls;
+		bool valid;
+	};
+
+	struct item_entry {
+		obs_source_t *scene;
+		obs_source_t *source;
+		bool valid;
+		uint32_t source_width;
+		uint32_t source_height;
+		uint32_t canvas_width;
+		uint32_t canvas_height;
+		int coverage;
+	};
+
+	std::mutex _lock;
+
+	// Interned type names, deque keeps the views in _type_ids valid
+	std::deque<std::string> _type_names;
+	std::vector<bool> _type_main_video;
+	std::unordered_map<std::string_view, source_type_id> _type_ids;
+
+	std::unordered_map<obs_source_t *, source_entry> _sources;
+	std::unordered_map<uint32_t, obs_source_t *> _source_ids;
+	uint32_t _next_source_id;
+	std::unordered_map<obs_sceneitem_t *, item_entry> _items;
+	// Scene sources with connected item signals
+	std::unordered_set<obs_source_t *> _scenes;
+	// Bumped by every item_transform so coverage computed concurrently is not cached stale
+	uint64_t _transform_epoch;
+
+public:
+	virtual ~source_classifier();
+	source_classifier();
+
+private:
+	static void source_updated(void *param, calldata_t *data);
+	static void source_destroyed(void *param, calldata_t *data);
+	static void scene_item_transform(void *param, calldata_t *data);
+	static void scene_item_remove(void *param, calldata_t *data);
+	static void scene_destroyed(void *param, calldata_t *data);
+
+	source_type_id intern_type(const char *id);
+
+	// Signal (dis)connection takes libobs signal locks, never call these while holding _lock
+	void connect_source(obs_source_t *source);
+
+	void disconnect_source(obs_source_t *source);
+
+	void connect_scene(obs_source_t *scene);
+
+	void disconnect_scene(obs_source_t *scene);
+
+public:
+	source_class classify(obs_source_t *source);
+
+	// Canvas coverage percentage of the item, compute is only called when the cached value is stale
+	int coverage(obs_sceneitem_t *item, uint32_t canvas_width, uint32_t canvas_height, coverage_func_t compute);
+
+	std::string type_name(source_type_id type);
+
+	// Name of a classified source, empty once the source is gone
+	std::string source_name(uint32_t id);
+
+	// Passes the name to proc without copying it, proc runs with _lock held and must not
+	// call back into the classifier. False without calling proc once the source is gone.
+	bool visit_source_name(uint32_t id, void (*proc)(void *param, std::string_view name), void *param);
+
+private /* Singleton */:
+	static std::shared_ptr<noice::source::source_classifier> _instance;
+
+public /* Singleton */:
+	static void initialize();
+
+	static void finalize();
+
+	static std::shared_ptr<noice::source::source_classifier> instance();
+};
+} // namespace noice::source
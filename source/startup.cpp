@@ -0,0 +1,166 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "startup.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <util/threading.h>
+#include "common.hpp"
+#include "util/util-profiler.hpp"
+#include "util/util-trace.hpp"
+
+namespace startup = noice::startup;
+
+static constexpr size_t STAGE_COUNT = (size_t)startup::stage::count;
+
+static const char *stage_names[STAGE_COUNT] = {"core", "identity", "config", "scene_collection"};
+static const char *trace_names[STAGE_COUNT] = {"startup.core", "startup.identity", "startup.config", "startup.scene_collection"};
+
+struct deferred_stage {
+	startup::stage id;
+	std::function<void()> fn;
+};
+
+static std::vector<deferred_stage> deferred;
+static std::thread lane;
+static std::atomic<bool> cancelled(false);
+// Steady clock at the beginning of the core stage
+static uint64_t epoch = 0;
+
+static std::mutex state_lock;
+static std::condition_variable state_changed;
+static startup::stage_timing states[STAGE_COUNT];
+
+const char *startup::stage_name(stage s)
+{
+	return (size_t)s < STAGE_COUNT ? stage_names[(size_t)s] : "unknown";
+}
+
+static void complete(startup::stage s, uint64_t start, uint64_t end, uint64_t trace_start, bool failed)
+{
+	if (noice::util::trace::enabled())
+		noice::util::trace::span(trace_names[(size_t)s], trace_start, noice::util::trace::now());
+	{
+		std::unique_lock<std::mutex> lock(state_lock);
+		startup::stage_timing &state = states[(size_t)s];
+		state.start = start - epoch;
+		state.duration = end - start;
+		state.done = true;
+		state.failed = failed;
+	}
+	state_changed.notify_all();
+
+	DLOG_INFO("Startup stage %s %s in %.3f ms", startup::stage_name(s), failed ? "failed" : "completed", (end - start) / 1000000.0);
+}
+
+void startup::run(stage s, const std::function<void()> &fn)
+{
+	uint64_t trace_start = noice::util::trace::now();
+	uint64_t start = noice::util::profiler::now();
+	if (s == stage::core)
+		epoch = start;
+
+	try {
+		fn();
+	} catch (...) {
+		complete(s, start, noice::util::profiler::now(), trace_start, true);
+		throw;
+	}
+	complete(s, start, noice::util::profiler::now(), trace_start, false);
+}
+
+void startup::defer(stage s, std::function<void()> fn)
+{
+	deferred.push_back({s, std::move(fn)});
+}
+
+static void lane_main()
+{
+	os_set_thread_name("noice startup thread");
+	noice::util::trace::set_thread_name("noice startup thread");
+
+	for (deferred_stage &d : deferred) {
+		if (cancelled.load(std::memory_order_acquire))
+			break;
+
+		try {
+			startup::run(d.id, d.fn);
+		} catch (const std::exception &ex) {
+			DLOG_ERROR("Startup stage %s: %s", startup::stage_name(d.id), ex.what());
+		} catch (...) {
+			DLOG_ERROR("Startup stage %s: unknown error", startup::stage_name(d.id));
+		}
+	}
+
+	if (cancelled.load(std::memory_order_acquire))
+		return;
+
+	uint64_t end = 0;
+	{
+		std::unique_lock<std::mutex> lock(state_lock);
+		for (const startup::stage_timing &state : states)
+			end = std::max(end, state.start + state.duration);
+	}
+	DLOG_INFO("Startup completed %.3f ms after load", end / 1000000.0);
+
+	signal_handler_signal(obs_get_signal_handler(), "noice_ready", nullptr);
+}
+
+void startup::start()
+{
+	cancelled.store(false, std::memory_order_release);
+	lane = std::thread(lane_main);
+}
+
+void startup::finish()
+{
+	cancelled.store(true, std::memory_order_release);
+	if (lane.joinable())
+		lane.join();
+	deferred.clear();
+
+	// Nobody is left to complete the skipped stages
+	{
+		std::unique_lock<std::mutex> lock(state_lock);
+		for (startup::stage_timing &state : states)
+			state.done = true;
+	}
+	state_changed.notify_all();
+}
+
+bool startup::ready(stage s)
+{
+	std::unique_lock<std::mutex> lock(state_lock);
+	return states[(size_t)s].done;
+}
+
+bool startup::wait(stage s, std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> lock(state_lock);
+	return state_changed.wait_for(lock, timeout, [s]() { return states[(size_t)s].done; });
+}
+
+std::vector<startup::stage_timing> startup::timings()
+{
+	std::unique_lock<std::mutex> lock(state_lock);
+	std::vector<stage_timing> result(states, states + STAGE_COUNT);
+	for (size_t i = 0; i < STAGE_COUNT; i++)
+		result[i].id = (stage)i;
+	return result;
+}
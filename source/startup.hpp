@@ -0,0 +1,71 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <chrono>
+#include <cinttypes>
+#include <functional>
+#include <vector>
+
+// Plugin startup in stages. Only what source registration and the docks need runs inside obs_module_load,
+// the rest is deferred to a background lane so loading the plugin does not hold up OBS.
+// Code depending on a deferred stage checks ready() or waits for it, "void noice_ready()"
+// is signalled on the global signal handler once every stage has run.
+namespace noice::startup {
+
+enum class stage : uint32_t {
+	// Singletons and source registration, inline
+	core,
+	// Machine id, generated and saved on first run, inline
+	identity,
+	// Deployment config files, downloaded when missing, and the game catalog
+	config,
+	// Scene collection watch and parse, SLOBS only
+	scene_collection,
+	count,
+};
+
+const char *stage_name(stage s);
+
+struct stage_timing {
+	stage id;
+	// Nanoseconds, start relative to the beginning of the core stage
+	uint64_t start;
+	uint64_t duration;
+	bool done;
+	bool failed;
+};
+
+// Runs a stage on the calling thread, exceptions are passed on
+void run(stage s, const std::function<void()> &fn);
+
+// Queues a stage for the background lane, in order, before start()
+void defer(stage s, std::function<void()> fn);
+
+// Starts the background lane on the deferred stages
+void start();
+
+// Waits for the lane, stages not started yet are skipped. Call before tearing down what
+// the stages touch.
+void finish();
+
+// Whether the stage has run, failed ones included
+bool ready(stage s);
+
+bool wait(stage s, std::chrono::milliseconds timeout);
+
+std::vector<stage_timing> timings();
+
+} // namespace noice::startup
@@ -19,8 +19,58 @@
 // SOFTWARE.
 
 #include "util-curl.hpp"
+#include "util-profiler.hpp"
+#include "util-trace.hpp"
+#include <algorithm>
+#include <mutex>
 #include <sstream>
 
+// Buffers kept for reuse, bigger ones are freed so one large download doesn't stay resident
+static constexpr size_t POOL_SIZE = 4;
+static constexpr size_t POOL_MAX_CAPACITY = 1024 * 1024;
+static constexpr size_t RESPONSE_INITIAL_CAPACITY = 16 * 1024;
+// Upper bound for reserving from Content-Length, the server may announce anything
+static constexpr curl_off_t RESPONSE_MAX_RESERVE = 64 * 1024 * 1024;
+
+struct response_pool {
+	std::mutex lock;
+	std::vector<std::string> buffers;
+};
+
+static response_pool &pool()
+{
+	// Never destroyed, responses may still be returned during static destruction
+	static response_pool *instance = new response_pool();
+	return *instance;
+}
+
+noice::util::curl_response::curl_response()
+{
+	response_pool &p = pool();
+	{
+		std::unique_lock<std::mutex> lock(p.lock);
+		if (!p.buffers.empty()) {
+			_buffer = std::move(p.buffers.back());
+			p.buffers.pop_back();
+		}
+	}
+
+	if (_buffer.capacity() < RESPONSE_INITIAL_CAPACITY)
+		_buffer.reserve(RESPONSE_INITIAL_CAPACITY);
+}
+
+noice::util::curl_response::~curl_response()
+{
+	if (_buffer.capacity() > POOL_MAX_CAPACITY)
+		return;
+
+	_buffer.clear();
+	response_pool &p = pool();
+	std::unique_lock<std::mutex> lock(p.lock);
+	if (p.buffers.size() < POOL_SIZE)
+		p.buffers.push_back(std::move(_buffer));
+}
+
 int32_t noice::util::curl::debug_helper(CURL *handle, curl_infotype type, char *data, size_t size, noice::util::curl *self)
 {
 	if (self->_debug_callback) {
@@ -138,6 +188,8 @@ size_t perform_get_kv_size(std::string_view a, std::string_view b)
 
 CURLcode noice::util::curl::perform()
 {
+	NOICE_PROFILE_SCOPE(http_request);
+	NOICE_TRACE_SCOPE("http_request");
 	std::vector<char> buffer;
 	struct curl_slist *headers = nullptr;
 
@@ -197,6 +249,22 @@ CURLcode noice::util::curl::set_write_callback(curl_io_callback_t cb)
 	return curl_easy_setopt(_curl, CURLOPT_WRITEFUNCTION, &write_helper);
 }
 
+CURLcode noice::util::curl::set_response(curl_response &response)
+{
+	response.clear();
+	return set_write_callback([this, &response](void *data, size_t size, size_t nmemb) -> size_t {
+		size_t length = size * nmemb;
+		if (response.empty()) {
+			// Headers are complete once the first body chunk arrives
+			curl_off_t announced = -1;
+			if (curl_easy_getinfo(_curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &announced) == CURLE_OK && announced > 0)
+				response.reserve((size_t)std::min(announced, RESPONSE_MAX_RESERVE));
+		}
+		response.append(reinterpret_cast<const char *>(data), length);
+		return length;
+	});
+}
+
 CURLcode noice::util::curl::set_xferinfo_callback(curl_xferinfo_callback_t cb)
 {
 	_xferinfo_callback = std::move(cb);
@@ -24,6 +24,7 @@
 #include <functional>
 #include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 
 extern "C" {
@@ -35,6 +36,34 @@ typedef std::function<size_t(void *, size_t, size_t)> curl_io_callback_t;
 typedef std::function<int32_t(uint64_t, uint64_t, uint64_t, uint64_t)> curl_xferinfo_callback_t;
 typedef std::function<void(CURL *, curl_infotype, char *, size_t)> curl_debug_callback_t;
 
+// Response body in a buffer borrowed from a process wide pool and handed back on
+// destruction, so repeated requests reuse warm buffers instead of growing a new stream
+// each time. Parsers read it in place through view().
+class curl_response {
+	std::string _buffer;
+
+public:
+	curl_response();
+	~curl_response();
+
+	curl_response(const curl_response &) = delete;
+	curl_response &operator=(const curl_response &) = delete;
+
+	void reserve(size_t size) { _buffer.reserve(size); }
+
+	void append(const char *data, size_t size) { _buffer.append(data, size); }
+
+	void clear() { _buffer.clear(); }
+
+	bool empty() const { return _buffer.empty(); }
+
+	size_t size() const { return _buffer.size(); }
+
+	const char *data() const { return _buffer.data(); }
+
+	std::string_view view() const { return _buffer; }
+};
+
 class curl {
 	CURL *_curl;
 	curl_io_callback_t _read_callback;
@@ -80,13 +109,24 @@ public:
 		return CURLE_OK;
 	};
 
+	// Points into memory owned by the handle, valid until the next request or option change
+	CURLcode get_info(CURLINFO info, std::string_view &value)
+	{
+		char *buffer = nullptr;
+		if (CURLcode res = curl_easy_getinfo(_curl, info, &buffer); res != CURLE_OK) {
+			return res;
+		}
+		value = buffer ? std::string_view(buffer) : std::string_view();
+		return CURLE_OK;
+	};
+
 	CURLcode get_info(CURLINFO info, std::string &value)
 	{
-		std::vector<char> buffer;
-		if (CURLcode res = get_info(info, buffer); res != CURLE_OK) {
+		std::string_view view;
+		if (CURLcode res = get_info(info, view); res != CURLE_OK) {
 			return res;
 		}
-		value = std::string(buffer.data(), buffer.data() + strlen(buffer.data()));
+		value.assign(view.data(), view.size());
 		return CURLE_OK;
 	};
 
@@ -115,6 +155,9 @@ public /* Helpers */:
 
 	CURLcode set_write_callback(curl_io_callback_t cb);
 
+	// Collects the body into response, reserving the announced Content-Length up front
+	CURLcode set_response(curl_response &response);
+
 	CURLcode set_xferinfo_callback(curl_xferinfo_callback_t cb);
 
 	CURLcode set_debug_callback(curl_debug_callback_t cb);
@@ -0,0 +1,250 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "util-json.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+static constexpr std::string_view REPLACEMENT_CHARACTER = "\xEF\xBF\xBD";
+
+noice::util::json_writer::json_writer(std::string &out) : _out(out), _has_values(0), _depth(0), _after_key(false)
+{
+	_out.clear();
+}
+
+void noice::util::json_writer::separate()
+{
+	if (_after_key) {
+		_after_key = false;
+		return;
+	}
+
+	// Nesting is limited to what the mask covers
+	uint64_t bit = _depth < 64 ? (uint64_t)1 << _depth : 0;
+	if (_has_values & bit)
+		_out.push_back(',');
+	_has_values |= bit;
+}
+
+void noice::util::json_writer::open(char c)
+{
+	separate();
+	_out.push_back(c);
+	_depth++;
+	if (_depth < 64)
+		_has_values &= ~((uint64_t)1 << _depth);
+}
+
+void noice::util::json_writer::close(char c)
+{
+	_out.push_back(c);
+	if (_depth > 0)
+		_depth--;
+}
+
+noice::util::json_writer &noice::util::json_writer::begin_object()
+{
+	open('{');
+	return *this;
+}
+
+noice::util::json_writer &noice::util::json_writer::end_object()
+{
+	close('}');
+	return *this;
+}
+
+noice::util::json_writer &noice::util::json_writer::begin_array()
+{
+	open('[');
+	return *this;
+}
+
+noice::util::json_writer &noice::util::json_writer::end_array()
+{
+	close(']');
+	return *this;
+}
+
+noice::util::json_writer &noice::util::json_writer::key(std::string_view name)
+{
+	separate();
+	write_string(name);
+	_out.push_back(':');
+	_after_key = true;
+	return *this;
+}
+
+noice::util::json_writer &noice::util::json_writer::value(std::string_view text)
+{
+	separate();
+	write_string(text);
+	return *this;
+}
+
+noice::util::json_writer &noice::util::json_writer::value(bool flag)
+{
+	separate();
+	_out.append(flag ? "true" : "false");
+	return *this;
+}
+
+noice::util::json_writer &noice::util::json_writer::value(double number)
+{
+	separate();
+	if (!std::isfinite(number)) {
+		_out.append("null");
+		return *this;
+	}
+
+	char buffer[32];
+	int length = snprintf(buffer, sizeof(buffer), "%.*g", std::numeric_limits<double>::digits10, number);
+	for (int i = 0; i < length; i++) {
+		// The decimal separator follows the C locale, which Qt may have changed
+		char c = buffer[i];
+		if ((c < '0' || c > '9') && c != '-' && c != '+' && c != 'e')
+			buffer[i] = '.';
+	}
+	_out.append(buffer, (size_t)length);
+	return *this;
+}
+
+noice::util::json_writer &noice::util::json_writer::null()
+{
+	separate();
+	_out.append("null");
+	return *this;
+}
+
+void noice::util::json_writer::write_int(int64_t number)
+{
+	char buffer[24];
+	auto res = std::to_chars(buffer, buffer + sizeof(buffer), number);
+	_out.append(buffer, res.ptr);
+}
+
+void noice::util::json_writer::write_uint(uint64_t number)
+{
+	char buffer[24];
+	auto res = std::to_chars(buffer, buffer + sizeof(buffer), number);
+	_out.append(buffer, res.ptr);
+}
+
+// Length of the valid UTF-8 sequence starting at text[pos], 0 if it is not valid
+static size_t utf8_sequence(std::string_view text, size_t pos)
+{
+	unsigned char lead = (unsigned char)text[pos];
+	size_t length;
+	unsigned char min = 0x80, max = 0xBF;
+	if (lead >= 0xC2 && lead <= 0xDF) {
+		length = 2;
+	} else if (lead >= 0xE0 && lead <= 0xEF) {
+		length = 3;
+		// Overlong forms and UTF-16 surrogates
+		if (lead == 0xE0)
+			min = 0xA0;
+		else if (lead == 0xED)
+			max = 0x9F;
+	} else if (lead >= 0xF0 && lead <= 0xF4) {
+		length = 4;
+		if (lead == 0xF0)
+			min = 0x90;
+		else if (lead == 0xF4)
+			max = 0x8F;
+	} else {
+		return 0;
+	}
+
+	if (pos + length > text.size())
+		return 0;
+	unsigned char second = (unsigned char)text[pos + 1];
+	if (second < min || second > max)
+		return 0;
+	for (size_t i = 2; i < length; i++) {
+		unsigned char c = (unsigned char)text[pos + i];
+		if (c < 0x80 || c > 0xBF)
+			return 0;
+	}
+	return length;
+}
+
+void noice::util::json_writer::write_string(std::string_view text)
+{
+	_out.push_back('"');
+
+	size_t pos = 0;
+	while (pos < text.size()) {
+		// Copy runs that need no escaping in one go
+		size_t run = pos;
+		while (run < text.size()) {
+			unsigned char c = (unsigned char)text[run];
+			if (c < 0x20 || c == '"' || c == '\\' || c >= 0x80)
+				break;
+			run++;
+		}
+		_out.append(text.data() + pos, run - pos);
+		pos = run;
+		if (pos == text.size())
+			break;
+
+		unsigned char c = (unsigned char)text[pos];
+		if (c >= 0x80) {
+			size_t length = utf8_sequence(text, pos);
+			if (length == 0) {
+				_out.append(REPLACEMENT_CHARACTER);
+				pos++;
+			} else {
+				_out.append(text.data() + pos, length);
+				pos += length;
+			}
+			continue;
+		}
+
+		switch (c) {
+		case '"':
+			_out.append("\\\"");
+			break;
+		case '\\':
+			_out.append("\\\\");
+			break;
+		case '\b':
+			_out.append("\\b");
+			break;
+		case '\f':
+			_out.append("\\f");
+			break;
+		case '\n':
+			_out.append("\\n");
+			break;
+		case '\r':
+			_out.append("\\r");
+			break;
+		case '\t':
+			_out.append("\\t");
+			break;
+		default: {
+			char escape[6] = {'\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0xF]};
+			_out.append(escape, sizeof(escape));
+			break;
+		}
+		}
+		pos++;
+	}
+
+	_out.push_back('"');
+}
@@ -0,0 +1,85 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <cinttypes>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace noice::util {
+
+// Writes JSON text straight into a caller owned buffer, for request bodies that would
+// otherwise be built as a nlohmann::json tree just to be dumped once. The buffer keeps its
+// capacity between documents, so a reused one stops allocating after the first few.
+//
+// Structure is not validated: containers are closed in the order they were opened, nest at
+// most 63 levels deep and object members start with key(). Strings are escaped like
+// nlohmann::json::dump, invalid UTF-8 is replaced with U+FFFD instead of throwing.
+class json_writer {
+	std::string &_out;
+	// Bit n is set once the container at depth n has a value, the next one needs a comma
+	uint64_t _has_values;
+	uint32_t _depth;
+	bool _after_key;
+
+	void separate();
+
+	void open(char c);
+
+	void close(char c);
+
+	void write_string(std::string_view text);
+
+	void write_int(int64_t number);
+
+	void write_uint(uint64_t number);
+
+public:
+	// Clears the buffer, capacity is kept
+	json_writer(std::string &out);
+
+	json_writer &begin_object();
+	json_writer &end_object();
+	json_writer &begin_array();
+	json_writer &end_array();
+
+	json_writer &key(std::string_view name);
+
+	json_writer &value(std::string_view text);
+	json_writer &value(const char *text) { return value(std::string_view(text ? text : "")); }
+	json_writer &value(const std::string &text) { return value(std::string_view(text)); }
+	json_writer &value(bool flag);
+	// NaN and infinities are written as null like nlohmann does
+	json_writer &value(double number);
+	json_writer &null();
+
+	template<typename T> std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, json_writer &> value(T number)
+	{
+		separate();
+		if constexpr (std::is_signed_v<T>) {
+			write_int((int64_t)number);
+		} else {
+			write_uint((uint64_t)number);
+		}
+		return *this;
+	}
+
+	template<typename T> json_writer &member(std::string_view name, const T &v) { return key(name).value(v); }
+
+	const std::string &str() const { return _out; }
+};
+
+} // namespace noice::util
@@ -0,0 +1,198 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "util-log.hpp"
+#include "util-trace.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <util/platform.h>
+#include <util/threading.h>
+
+namespace logger = noice::util::log;
+
+static constexpr uint64_t CALLSITE_WINDOW_NS = 1000000000;
+
+// Longer lines are truncated
+static constexpr size_t MESSAGE_SIZE = 512;
+static constexpr uint64_t SLOT_COUNT = 1024;
+
+static constexpr auto IDLE_WAIT = std::chrono::milliseconds(50);
+
+struct log_slot {
+	// Bounded MPSC queue slot, equal to the position when free for that position and
+	// position + 1 once written
+	std::atomic<uint64_t> sequence;
+	int level;
+	char message[MESSAGE_SIZE];
+};
+
+static log_slot slots[SLOT_COUNT];
+static std::atomic<uint64_t> tail(0);
+static uint64_t head = 0;
+// Lines lost to a full ring, reported by the consumer
+static std::atomic<uint32_t> overflowed(0);
+
+static std::atomic<bool> running(false);
+static std::atomic<bool> stopping(false);
+static std::atomic<bool> sleeping(false);
+static std::mutex wake_lock;
+static std::condition_variable wake;
+static std::thread consumer;
+
+#pragma mark Rate limit
+
+bool logger::callsite::allow(uint32_t &suppressed)
+{
+	uint64_t window = os_gettime_ns() / CALLSITE_WINDOW_NS;
+	uint64_t current = _window.load(std::memory_order_relaxed);
+	// Racing threads may let a message or two more through at a window change
+	if (window != current && _window.compare_exchange_strong(current, window, std::memory_order_relaxed))
+		_count.store(0, std::memory_order_relaxed);
+
+	if (_count.fetch_add(1, std::memory_order_relaxed) >= CALLSITE_BURST) {
+		_suppressed.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	suppressed = _suppressed.exchange(0, std::memory_order_relaxed);
+	return true;
+}
+
+#pragma mark Queue
+
+static log_slot *claim_slot(uint64_t &position)
+{
+	position = tail.load(std::memory_order_relaxed);
+	for (;;) {
+		log_slot &slot = slots[position % SLOT_COUNT];
+		int64_t diff = (int64_t)(slot.sequence.load(std::memory_order_acquire) - position);
+		if (diff == 0) {
+			if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				return &slot;
+		} else if (diff < 0) {
+			// The consumer is a full ring behind
+			return nullptr;
+		} else {
+			position = tail.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+static void format_message(char *buffer, uint32_t suppressed, const char *format, va_list args)
+{
+	int length = vsnprintf(buffer, MESSAGE_SIZE, format, args);
+	if (length < 0) {
+		buffer[0] = 0;
+		length = 0;
+	}
+
+	if (suppressed > 0 && (size_t)length < MESSAGE_SIZE)
+		snprintf(buffer + length, MESSAGE_SIZE - length, " (%" PRIu32 " similar messages suppressed)", suppressed);
+}
+
+// Consumer thread only, or finalize() once the consumer is gone
+static bool drain()
+{
+	bool drained = false;
+	for (;;) {
+		log_slot &slot = slots[head % SLOT_COUNT];
+		if (slot.sequence.load(std::memory_order_acquire) != head + 1)
+			break;
+
+		blog(slot.level, "%s", slot.message);
+		slot.sequence.store(head + SLOT_COUNT, std::memory_order_release);
+		head++;
+		drained = true;
+	}
+
+	uint32_t lost = overflowed.exchange(0, std::memory_order_relaxed);
+	if (lost > 0)
+		blog(LOG_WARNING, "[Noice] Log queue full, %" PRIu32 " messages dropped", lost);
+	return drained;
+}
+
+static void consumer_thread()
+{
+	os_set_thread_name("noice log thread");
+	noice::util::trace::set_thread_name("noice log thread");
+
+	while (!stopping.load(std::memory_order_acquire)) {
+		if (drain())
+			continue;
+
+		std::unique_lock<std::mutex> lock(wake_lock);
+		sleeping.store(true, std::memory_order_seq_cst);
+		// Producers never take the lock, a missed wake up only delays the next drain
+		wake.wait_for(lock, IDLE_WAIT);
+		sleeping.store(false, std::memory_order_relaxed);
+	}
+	drain();
+}
+
+void logger::initialize()
+{
+	if (running.load(std::memory_order_relaxed))
+		return;
+
+	for (uint64_t position = head; position < head + SLOT_COUNT; position++)
+		slots[position % SLOT_COUNT].sequence.store(position, std::memory_order_relaxed);
+	tail.store(head, std::memory_order_relaxed);
+
+	stopping.store(false, std::memory_order_relaxed);
+	consumer = std::thread(consumer_thread);
+	running.store(true, std::memory_order_release);
+}
+
+void logger::finalize()
+{
+	if (!running.exchange(false, std::memory_order_acq_rel))
+		return;
+
+	stopping.store(true, std::memory_order_release);
+	wake.notify_one();
+	consumer.join();
+
+	// Lines queued by writers that saw the logger running just before it stopped
+	drain();
+}
+
+void logger::write(int level, uint32_t suppressed, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+
+	uint64_t position = 0;
+	log_slot *slot = running.load(std::memory_order_acquire) ? claim_slot(position) : nullptr;
+	if (slot) {
+		slot->level = level;
+		format_message(slot->message, suppressed, format, args);
+		slot->sequence.store(position + 1, std::memory_order_release);
+
+		if (sleeping.load(std::memory_order_seq_cst))
+			wake.notify_one();
+	} else if (running.load(std::memory_order_relaxed)) {
+		overflowed.fetch_add(1, std::memory_order_relaxed);
+	} else {
+		char message[MESSAGE_SIZE];
+		format_message(message, suppressed, format, args);
+		blog(level, "%s", message);
+	}
+
+	va_end(args);
+}
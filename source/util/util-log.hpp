@@ -0,0 +1,71 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <atomic>
+#include <cinttypes>
+#include <util/base.h>
+
+// Most verbose level compiled in, messages above it cost nothing
+#ifndef NOICE_LOG_LEVEL
+#define NOICE_LOG_LEVEL LOG_INFO
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define NOICE_LOG_PRINTF(fmt, args) __attribute__((format(printf, fmt, args)))
+#else
+#define NOICE_LOG_PRINTF(fmt, args)
+#endif
+
+// Log lines are formatted on the calling thread into a lock-free ring and handed to blog
+// by a background thread, so logging never waits on the OBS log lock or file writes.
+// Before initialize() and after finalize() lines go straight to blog.
+namespace noice::util::log {
+
+// Messages passed per call site and second, further ones are counted and dropped
+static constexpr uint32_t CALLSITE_BURST = 32;
+
+class callsite {
+	std::atomic<uint64_t> _window;
+	std::atomic<uint32_t> _count;
+	std::atomic<uint32_t> _suppressed;
+
+public:
+	callsite() : _window(0), _count(0), _suppressed(0) {}
+
+	// Whether a message may be logged, suppressed receives how many were dropped
+	// since the last one that passed
+	bool allow(uint32_t &suppressed);
+};
+
+void initialize();
+
+// Drains everything queued and stops the background thread
+void finalize();
+
+void write(int level, uint32_t suppressed, const char *format, ...) NOICE_LOG_PRINTF(3, 4);
+
+} // namespace noice::util::log
+
+// Arguments are only evaluated for messages that pass the level filter and rate limit
+#define NOICE_LOG(level, ...)                                                                 \
+	do {                                                                                  \
+		if ((level) <= NOICE_LOG_LEVEL) {                                             \
+			static noice::util::log::callsite _log_callsite;                      \
+			uint32_t _log_suppressed = 0;                                         \
+			if (_log_callsite.allow(_log_suppressed))                             \
+				noice::util::log::write(level, _log_suppressed, __VA_ARGS__); \
+		}                                                                             \
+	} while (0)
@@ -0,0 +1,204 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "util-profiler.hpp"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace profiler = noice::util::profiler;
+
+static constexpr size_t PROBE_COUNT = (size_t)profiler::probe::count;
+
+static const char *probe_names[PROBE_COUNT] = {
+	"video_render", "source_draw", "tick_handler", "refresh_main", "scenecollection_parse", "http_request",
+};
+
+static inline uint32_t highest_bit(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return (uint32_t)index;
+#else
+	return 63u - (uint32_t)__builtin_clzll(value);
+#endif
+}
+
+#pragma mark Histogram
+
+profiler::histogram::histogram() : _max(0)
+{
+	for (std::atomic<uint64_t> &count : _counts)
+		count.store(0, std::memory_order_relaxed);
+}
+
+uint32_t profiler::histogram::bucket(uint64_t value)
+{
+	if (value < SUB_COUNT)
+		return (uint32_t)value;
+
+	uint32_t exponent = std::min(highest_bit(value), MAX_BITS);
+	if (exponent == MAX_BITS)
+		value = std::min(value, (uint64_t(1) << (MAX_BITS + 1)) - 1);
+
+	uint32_t shift = exponent - SUB_BITS;
+	uint32_t sub = (uint32_t)(value >> shift) - SUB_COUNT;
+	return (shift + 1) * SUB_COUNT + sub;
+}
+
+uint64_t profiler::histogram::bucket_value(uint32_t index)
+{
+	if (index < SUB_COUNT)
+		return index;
+
+	uint32_t shift = index / SUB_COUNT - 1;
+	uint64_t low = uint64_t(SUB_COUNT + index % SUB_COUNT) << shift;
+	return low + (uint64_t(1) << shift) - 1;
+}
+
+void profiler::histogram::merge_into(uint64_t *counts, uint64_t &max) const
+{
+	for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+		counts[i] += _counts[i].load(std::memory_order_relaxed);
+	max = std::max(max, _max.load(std::memory_order_relaxed));
+}
+
+void profiler::histogram::clear()
+{
+	for (std::atomic<uint64_t> &count : _counts)
+		count.store(0, std::memory_order_relaxed);
+	_max.store(0, std::memory_order_relaxed);
+}
+
+#pragma mark Per thread storage
+
+// Histograms outlive the threads that wrote them so their samples stay queryable, and
+// are handed to the next new thread instead of piling up with short lived threads
+struct histogram_registry {
+	std::mutex lock;
+	std::vector<std::unique_ptr<profiler::histogram>> histograms[PROBE_COUNT];
+	std::vector<profiler::histogram *> retired[PROBE_COUNT];
+};
+
+static histogram_registry &registry()
+{
+	// Never destroyed, threads may still retire histograms after static destruction
+	static histogram_registry *instance = new histogram_registry();
+	return *instance;
+}
+
+struct thread_histograms {
+	profiler::histogram *probes[PROBE_COUNT] = {};
+
+	~thread_histograms()
+	{
+		histogram_registry &r = registry();
+		std::unique_lock<std::mutex> lock(r.lock);
+		for (size_t i = 0; i < PROBE_COUNT; i++) {
+			if (probes[i])
+				r.retired[i].push_back(probes[i]);
+		}
+	}
+
+	profiler::histogram *acquire(size_t index)
+	{
+		histogram_registry &r = registry();
+		std::unique_lock<std::mutex> lock(r.lock);
+		if (!r.retired[index].empty()) {
+			probes[index] = r.retired[index].back();
+			r.retired[index].pop_back();
+		} else {
+			r.histograms[index].push_back(std::make_unique<profiler::histogram>());
+			probes[index] = r.histograms[index].back().get();
+		}
+		return probes[index];
+	}
+};
+
+static thread_local thread_histograms local_histograms;
+
+#pragma mark Queries
+
+const char *profiler::probe_name(probe p)
+{
+	size_t index = (size_t)p;
+	return index < PROBE_COUNT ? probe_names[index] : "";
+}
+
+void profiler::record(probe p, uint64_t duration)
+{
+	size_t index = (size_t)p;
+	histogram *h = local_histograms.probes[index];
+	if (!h)
+		h = local_histograms.acquire(index);
+	h->record(duration);
+}
+
+profiler::summary profiler::query(probe p)
+{
+	size_t index = (size_t)p;
+	std::vector<uint64_t> counts(histogram::BUCKET_COUNT, 0);
+	summary result = {};
+
+	{
+		histogram_registry &r = registry();
+		std::unique_lock<std::mutex> lock(r.lock);
+		for (auto &h : r.histograms[index])
+			h->merge_into(counts.data(), result.max);
+	}
+
+	for (uint64_t count : counts)
+		result.count += count;
+	if (result.count == 0)
+		return result;
+
+	// Ranks rounded up, p99 of 10 samples is the largest one
+	uint64_t rank50 = (result.count * 50 + 99) / 100;
+	uint64_t rank95 = (result.count * 95 + 99) / 100;
+	uint64_t rank99 = (result.count * 99 + 99) / 100;
+
+	uint64_t seen = 0;
+	for (uint32_t i = 0; i < histogram::BUCKET_COUNT; i++) {
+		if (counts[i] == 0)
+			continue;
+		uint64_t before = seen;
+		seen += counts[i];
+		uint64_t value = std::min(histogram::bucket_value(i), result.max);
+		if (before < rank50 && seen >= rank50)
+			result.p50 = value;
+		if (before < rank95 && seen >= rank95)
+			result.p95 = value;
+		if (before < rank99 && seen >= rank99)
+			result.p99 = value;
+	}
+	return result;
+}
+
+void profiler::reset()
+{
+	// Racing writers may keep a sample or two from before the reset
+	histogram_registry &r = registry();
+	std::unique_lock<std::mutex> lock(r.lock);
+	for (auto &histograms : r.histograms) {
+		for (auto &h : histograms)
+			h->clear();
+	}
+}
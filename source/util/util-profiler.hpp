@@ -0,0 +1,125 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+
+// Compile time switch, scopes compile to nothing when disabled
+#ifndef NOICE_PROFILER
+#define NOICE_PROFILER 0
+#endif
+
+namespace noice::util::profiler {
+
+// Instrumented hot paths
+enum class probe : uint32_t {
+	video_render,
+	source_draw,
+	tick_handler,
+	refresh_main,
+	scenecollection_parse,
+	http_request,
+	count,
+};
+
+const char *probe_name(probe p);
+
+// Log-linear histogram of nanosecond durations, 32 sub-buckets per power of two so any
+// recorded value is off by at most ~3%. Written by a single thread, readable from any.
+class histogram {
+public:
+	static constexpr uint32_t SUB_BITS = 5;
+	static constexpr uint32_t SUB_COUNT = 1u << SUB_BITS;
+	// Durations above 2^36 ns (~68 s) land in the last bucket
+	static constexpr uint32_t MAX_BITS = 36;
+	static constexpr uint32_t BUCKET_COUNT = (MAX_BITS - SUB_BITS + 2) * SUB_COUNT;
+
+private:
+	std::atomic<uint64_t> _counts[BUCKET_COUNT];
+	std::atomic<uint64_t> _max;
+
+public:
+	histogram();
+
+	static uint32_t bucket(uint64_t value);
+
+	// Highest value landing in the bucket
+	static uint64_t bucket_value(uint32_t index);
+
+	// Owner thread only
+	void record(uint64_t value)
+	{
+		std::atomic<uint64_t> &count = _counts[bucket(value)];
+		count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		if (value > _max.load(std::memory_order_relaxed))
+			_max.store(value, std::memory_order_relaxed);
+	}
+
+	void merge_into(uint64_t *counts, uint64_t &max) const;
+
+	void clear();
+};
+
+struct summary {
+	uint64_t count;
+	// Nanoseconds
+	uint64_t p50;
+	uint64_t p95;
+	uint64_t p99;
+	uint64_t max;
+};
+
+inline uint64_t now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+void record(probe p, uint64_t duration);
+
+// Merged over every thread that ever recorded the probe
+summary query(probe p);
+
+void reset();
+
+class scope {
+	probe _probe;
+	uint64_t _start;
+
+	scope(const scope &) = delete;
+	scope &operator=(const scope &) = delete;
+
+public:
+	scope(probe p) : _probe(p), _start(now()) {}
+
+	~scope() { record(_probe, now() - _start); }
+};
+
+} // namespace noice::util::profiler
+
+#define NOICE_PROFILE_CONCAT2(a, b) a##b
+#define NOICE_PROFILE_CONCAT(a, b) NOICE_PROFILE_CONCAT2(a, b)
+
+#if NOICE_PROFILER
+#define NOICE_PROFILE_SCOPE(p) \
+	noice::util::profiler::scope NOICE_PROFILE_CONCAT(_profile_scope_, __LINE__)(noice::util::profiler::probe::p)
+#else
+#define NOICE_PROFILE_SCOPE(p) \
+	do {                   \
+	} while (0)
+#endif
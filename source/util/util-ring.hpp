@@ -0,0 +1,80 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace noice::util {
+
+// Bounded lock-free single producer / single consumer queue. Capacity is rounded up to a
+// power of two. Never allocates after construction, push fails when the queue is full.
+template<typename T> class spsc_ring {
+	std::unique_ptr<T[]> _items;
+	size_t _mask;
+
+	alignas(64) std::atomic<size_t> _head; // next slot to read, owned by the consumer
+	alignas(64) std::atomic<size_t> _tail; // next slot to write, owned by the producer
+
+	spsc_ring(const spsc_ring &) = delete;
+	spsc_ring &operator=(const spsc_ring &) = delete;
+
+public:
+	spsc_ring(size_t capacity) : _head(0), _tail(0)
+	{
+		size_t size = 1;
+		while (size < capacity)
+			size <<= 1;
+		_items = std::make_unique<T[]>(size);
+		_mask = size - 1;
+	}
+
+	bool push(const T &item)
+	{
+		T copy(item);
+		return push(std::move(copy));
+	}
+
+	// Leaves item untouched when the queue is full
+	bool push(T &&item)
+	{
+		size_t tail = _tail.load(std::memory_order_relaxed);
+		if (tail - _head.load(std::memory_order_acquire) > _mask)
+			return false;
+
+		_items[tail & _mask] = std::move(item);
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T &item)
+	{
+		size_t head = _head.load(std::memory_order_relaxed);
+		if (head == _tail.load(std::memory_order_acquire))
+			return false;
+
+		item = std::move(_items[head & _mask]);
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool empty() const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire); }
+
+	size_t capacity() const { return _mask + 1; }
+};
+
+} // namespace noice::util
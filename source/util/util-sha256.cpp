@@ -0,0 +1,151 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "util-sha256.hpp"
+#include <cstring>
+
+static constexpr uint32_t ROUND_CONSTANTS[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be,
+	0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa,
+	0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85,
+	0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
+	0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t rotr(uint32_t x, uint32_t n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+static inline uint32_t load_be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline void store_be32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)(v >> 24);
+	p[1] = (uint8_t)(v >> 16);
+	p[2] = (uint8_t)(v >> 8);
+	p[3] = (uint8_t)v;
+}
+
+noice::util::sha256::sha256()
+{
+	reset();
+}
+
+void noice::util::sha256::reset()
+{
+	static constexpr uint32_t initial[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+	};
+	memcpy(_state, initial, sizeof(_state));
+	_length = 0;
+	_used = 0;
+}
+
+void noice::util::sha256::compress(const uint8_t *block)
+{
+	uint32_t w[64];
+	for (size_t i = 0; i < 16; i++)
+		w[i] = load_be32(block + i * 4);
+	for (size_t i = 16; i < 64; i++) {
+		uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	uint32_t a = _state[0], b = _state[1], c = _state[2], d = _state[3];
+	uint32_t e = _state[4], f = _state[5], g = _state[6], h = _state[7];
+	for (size_t i = 0; i < 64; i++) {
+		uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + ROUND_CONSTANTS[i] + w[i];
+		uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	_state[0] += a;
+	_state[1] += b;
+	_state[2] += c;
+	_state[3] += d;
+	_state[4] += e;
+	_state[5] += f;
+	_state[6] += g;
+	_state[7] += h;
+}
+
+void noice::util::sha256::update(const void *data, size_t size)
+{
+	const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+	_length += size;
+
+	if (_used > 0) {
+		size_t take = sizeof(_block) - _used < size ? sizeof(_block) - _used : size;
+		memcpy(_block + _used, bytes, take);
+		_used += take;
+		bytes += take;
+		size -= take;
+		if (_used < sizeof(_block))
+			return;
+		compress(_block);
+		_used = 0;
+	}
+
+	// Whole blocks straight from the input
+	for (; size >= sizeof(_block); bytes += sizeof(_block), size -= sizeof(_block))
+		compress(bytes);
+
+	memcpy(_block, bytes, size);
+	_used = size;
+}
+
+void noice::util::sha256::finish(uint8_t digest[DIGEST_SIZE])
+{
+	uint64_t bits = _length * 8;
+
+	_block[_used++] = 0x80;
+	if (_used > 56) {
+		memset(_block + _used, 0, sizeof(_block) - _used);
+		compress(_block);
+		_used = 0;
+	}
+	memset(_block + _used, 0, 56 - _used);
+	store_be32(_block + 56, (uint32_t)(bits >> 32));
+	store_be32(_block + 60, (uint32_t)bits);
+	compress(_block);
+
+	for (size_t i = 0; i < 8; i++)
+		store_be32(digest + i * 4, _state[i]);
+}
+
+void noice::util::sha256::finish_hex(char hex[HEX_SIZE])
+{
+	static constexpr char digits[] = "0123456789abcdef";
+	uint8_t digest[DIGEST_SIZE];
+	finish(digest);
+	for (size_t i = 0; i < DIGEST_SIZE; i++) {
+		hex[i * 2] = digits[digest[i] >> 4];
+		hex[i * 2 + 1] = digits[digest[i] & 0xF];
+	}
+	hex[DIGEST_SIZE * 2] = 0;
+}
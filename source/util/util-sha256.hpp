@@ -0,0 +1,51 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+
+namespace noice::util {
+
+// Incremental SHA-256 (FIPS 180-4), so downloads can be verified while they stream in
+// instead of being read back afterwards
+class sha256 {
+public:
+	static constexpr size_t DIGEST_SIZE = 32;
+	// Lowercase hex digits and the terminating NUL
+	static constexpr size_t HEX_SIZE = DIGEST_SIZE * 2 + 1;
+
+private:
+	uint32_t _state[8];
+	uint64_t _length;
+	uint8_t _block[64];
+	size_t _used;
+
+	void compress(const uint8_t *block);
+
+public:
+	sha256();
+
+	void reset();
+
+	void update(const void *data, size_t size);
+
+	// The hash must be reset before it is updated again
+	void finish(uint8_t digest[DIGEST_SIZE]);
+
+	void finish_hex(char hex[HEX_SIZE]);
+};
+
+} // namespace noice::util
@@ -0,0 +1,283 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "util-trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#include <unistd.h>
+#else
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace trace = noice::util::trace;
+
+// Events kept per thread, 32 bytes each
+static constexpr uint64_t RING_SIZE = 8192;
+
+std::atomic<bool> trace::_enabled(false);
+
+static std::atomic<uint64_t> started_at(0);
+
+enum class event_kind : uint32_t {
+	span,
+	counter,
+};
+
+// Fields are relaxed atomics so a dump racing with the owner thread overwriting a slot
+// reads stale values instead of tearing, such slots are dropped afterwards
+struct trace_event {
+	std::atomic<const char *> name;
+	std::atomic<uint64_t> time;
+	// Duration of spans, value of counters
+	std::atomic<int64_t> value;
+	std::atomic<uint32_t> tid;
+	std::atomic<event_kind> kind;
+};
+
+struct event_ring {
+	std::unique_ptr<trace_event[]> events;
+	// Total events ever written, the next slot is head % RING_SIZE
+	std::atomic<uint64_t> head;
+
+	event_ring() : events(std::make_unique<trace_event[]>(RING_SIZE)), head(0) {}
+};
+
+// Rings outlive their threads so a dump still shows what exited threads did, and are
+// handed to new threads instead of piling up with short lived threads
+struct ring_registry {
+	std::mutex lock;
+	std::vector<std::unique_ptr<event_ring>> rings;
+	std::vector<event_ring *> retired;
+	std::map<uint32_t, std::string> thread_names;
+};
+
+static ring_registry &registry()
+{
+	// Never destroyed, threads may still retire rings after static destruction
+	static ring_registry *instance = new ring_registry();
+	return *instance;
+}
+
+static uint32_t current_tid()
+{
+#if defined(_WIN32)
+	return (uint32_t)GetCurrentThreadId();
+#elif defined(__APPLE__)
+	uint64_t tid = 0;
+	pthread_threadid_np(nullptr, &tid);
+	return (uint32_t)tid;
+#else
+	return (uint32_t)syscall(SYS_gettid);
+#endif
+}
+
+static uint32_t current_pid()
+{
+#if defined(_WIN32)
+	return (uint32_t)GetCurrentProcessId();
+#else
+	return (uint32_t)getpid();
+#endif
+}
+
+struct thread_ring {
+	event_ring *ring = nullptr;
+	uint32_t tid = 0;
+
+	~thread_ring()
+	{
+		if (!ring)
+			return;
+		ring_registry &r = registry();
+		std::unique_lock<std::mutex> lock(r.lock);
+		r.retired.push_back(ring);
+	}
+
+	void acquire()
+	{
+		tid = current_tid();
+		ring_registry &r = registry();
+		std::unique_lock<std::mutex> lock(r.lock);
+		if (!r.retired.empty()) {
+			ring = r.retired.back();
+			r.retired.pop_back();
+		} else {
+			r.rings.push_back(std::make_unique<event_ring>());
+			ring = r.rings.back().get();
+		}
+	}
+
+	void push(event_kind kind, const char *name, uint64_t time, int64_t value)
+	{
+		if (!ring)
+			acquire();
+
+		uint64_t head = ring->head.load(std::memory_order_relaxed);
+		trace_event &event = ring->events[head % RING_SIZE];
+		event.name.store(name, std::memory_order_relaxed);
+		event.time.store(time, std::memory_order_relaxed);
+		event.value.store(value, std::memory_order_relaxed);
+		event.tid.store(tid, std::memory_order_relaxed);
+		event.kind.store(kind, std::memory_order_relaxed);
+		ring->head.store(head + 1, std::memory_order_release);
+	}
+};
+
+static thread_local thread_ring local_ring;
+
+#pragma mark Recording
+
+void trace::start()
+{
+	started_at.store(now(), std::memory_order_relaxed);
+	_enabled.store(true, std::memory_order_relaxed);
+}
+
+void trace::stop()
+{
+	_enabled.store(false, std::memory_order_relaxed);
+}
+
+uint64_t trace::now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+void trace::span(const char *name, uint64_t begin, uint64_t end)
+{
+	local_ring.push(event_kind::span, name, begin, (int64_t)(end - begin));
+}
+
+void trace::counter(const char *name, int64_t value)
+{
+	if (enabled())
+		local_ring.push(event_kind::counter, name, now(), value);
+}
+
+void trace::set_thread_name(const char *name)
+{
+	ring_registry &r = registry();
+	std::unique_lock<std::mutex> lock(r.lock);
+	r.thread_names[current_tid()] = name;
+}
+
+#pragma mark Export
+
+struct event_copy {
+	const char *name;
+	uint64_t time;
+	int64_t value;
+	uint32_t tid;
+	event_kind kind;
+};
+
+static void copy_ring(const event_ring &ring, std::vector<event_copy> &out)
+{
+	uint64_t head = ring.head.load(std::memory_order_acquire);
+	uint64_t first = head > RING_SIZE ? head - RING_SIZE : 0;
+
+	size_t offset = out.size();
+	for (uint64_t i = first; i < head; i++) {
+		const trace_event &event = ring.events[i % RING_SIZE];
+		out.push_back({event.name.load(std::memory_order_relaxed), event.time.load(std::memory_order_relaxed),
+			       event.value.load(std::memory_order_relaxed), event.tid.load(std::memory_order_relaxed),
+			       event.kind.load(std::memory_order_relaxed)});
+	}
+
+	// Slots the owner started overwriting while we copied can't be trusted
+	uint64_t after = ring.head.load(std::memory_order_acquire);
+	if (after >= RING_SIZE && after - RING_SIZE >= first) {
+		size_t overwritten = (size_t)std::min(after - RING_SIZE + 1 - first, head - first);
+		out.erase(out.begin() + offset, out.begin() + offset + overwritten);
+	}
+}
+
+static void write_string(std::ostream &out, const char *value)
+{
+	out << '"';
+	for (const char *c = value; c && *c; c++) {
+		if (*c == '"' || *c == '\\')
+			out << '\\' << *c;
+		else if ((unsigned char)*c < 0x20)
+			out << ' ';
+		else
+			out << *c;
+	}
+	out << '"';
+}
+
+// Trace-event timestamps are microseconds
+static void write_time(std::ostream &out, uint64_t ns)
+{
+	char fraction[4] = {char('0' + ns / 100 % 10), char('0' + ns / 10 % 10), char('0' + ns % 10), 0};
+	out << ns / 1000 << '.' << fraction;
+}
+
+void trace::write_json(std::ostream &out)
+{
+	std::vector<event_copy> events;
+	std::map<uint32_t, std::string> thread_names;
+	{
+		ring_registry &r = registry();
+		std::unique_lock<std::mutex> lock(r.lock);
+		for (auto &ring : r.rings)
+			copy_ring(*ring, events);
+		thread_names = r.thread_names;
+	}
+
+	uint32_t pid = current_pid();
+	uint64_t since = started_at.load(std::memory_order_relaxed);
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"name\":\"obs-noice\"}}";
+	for (auto &it : thread_names) {
+		out << ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << it.first << ",\"args\":{\"name\":";
+		write_string(out, it.second.c_str());
+		out << "}}";
+	}
+
+	for (const event_copy &event : events) {
+		// Left over from an earlier recording
+		if (event.time < since)
+			continue;
+
+		out << ",{\"name\":";
+		write_string(out, event.name);
+		out << ",\"cat\":\"noice\",\"pid\":" << pid << ",\"tid\":" << event.tid << ",\"ts\":";
+		write_time(out, event.time);
+		if (event.kind == event_kind::span) {
+			out << ",\"ph\":\"X\",\"dur\":";
+			write_time(out, (uint64_t)event.value);
+		} else {
+			out << ",\"ph\":\"C\",\"args\":{\"value\":" << event.value << "}";
+		}
+		out << "}";
+	}
+	out << "]}";
+}
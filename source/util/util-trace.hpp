@@ -0,0 +1,72 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <atomic>
+#include <cinttypes>
+#include <ostream>
+
+// Opt-in recording of spans and counters for Chrome trace-event JSON, loadable in
+// Perfetto or chrome://tracing. Every thread records into its own fixed size ring that
+// keeps the most recent events, recording never locks or allocates after the first event
+// of a thread. Timestamps come from the monotonic clock OBS uses for its own timing.
+namespace noice::util::trace {
+
+extern std::atomic<bool> _enabled;
+
+inline bool enabled()
+{
+	return _enabled.load(std::memory_order_relaxed);
+}
+
+void start();
+
+void stop();
+
+uint64_t now();
+
+// Names must be string literals or otherwise outlive the trace
+void span(const char *name, uint64_t begin, uint64_t end);
+
+void counter(const char *name, int64_t value);
+
+// Names the calling thread in the trace
+void set_thread_name(const char *name);
+
+// Writes the recorded events, safe while recording continues
+void write_json(std::ostream &out);
+
+class scope {
+	const char *_name;
+	uint64_t _start;
+
+	scope(const scope &) = delete;
+	scope &operator=(const scope &) = delete;
+
+public:
+	scope(const char *name) : _name(name), _start(enabled() ? now() : 0) {}
+
+	~scope()
+	{
+		if (_start != 0 && enabled())
+			span(_name, _start, now());
+	}
+};
+
+} // namespace noice::util::trace
+
+#define NOICE_TRACE_CONCAT2(a, b) a##b
+#define NOICE_TRACE_CONCAT(a, b) NOICE_TRACE_CONCAT2(a, b)
+#define NOICE_TRACE_SCOPE(name) noice::util::trace::scope NOICE_TRACE_CONCAT(_trace_scope_, __LINE__)(name)
@@ -0,0 +1,747 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "validation.hpp"
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+noice::validation::transform noice::validation::multiply(const transform &a, const transform &b)
+{
+	transform out;
+	out.x = {a.x.x * b.x.x + a.x.y * b.y.x, a.x.x * b.x.y + a.x.y * b.y.y};
+	out.y = {a.y.x * b.x.x + a.y.y * b.y.x, a.y.x * b.x.y + a.y.y * b.y.y};
+	out.t = {a.t.x * b.x.x + a.t.y * b.y.x + b.t.x, a.t.x * b.x.y + a.t.y * b.y.y + b.t.y};
+	return out;
+}
+
+noice::validation::point noice::validation::apply(const transform &m, point p)
+{
+	return {p.x * m.x.x + p.y * m.y.x + m.t.x, p.x * m.x.y + p.y * m.y.y + m.t.y};
+}
+
+bool noice::validation::invert(const transform &m, transform &out)
+{
+	float det = m.x.x * m.y.y - m.x.y * m.y.x;
+	if (det == 0.0f || !std::isfinite(det))
+		return false;
+
+	float inv_det = 1.0f / det;
+	out.x = {m.y.y * inv_det, -m.x.y * inv_det};
+	out.y = {-m.y.x * inv_det, m.x.x * inv_det};
+	out.t = {-(m.t.x * out.x.x + m.t.y * out.y.x), -(m.t.x * out.x.y + m.t.y * out.y.y)};
+	return true;
+}
+
+#pragma mark Separating axis test
+
+// Same semantics as minps/maxps so the scalar and vector kernels agree bit for bit
+static inline float lane_min(float a, float b)
+{
+	return a < b ? a : b;
+}
+
+static inline float lane_max(float a, float b)
+{
+	return a > b ? a : b;
+}
+
+// Item box as an oriented quad with everything the separating axis test needs from the
+// item side precomputed. Flips and crop are part of the box transform already.
+struct item_quad {
+	noice::validation::transform m;
+	noice::validation::point corners[4];
+
+	// Projection onto the canvas axes
+	float min_x, max_x, min_y, max_y;
+
+	// Projection onto the normals of the quad edges
+	noice::validation::point normals[2];
+	float normal_min[2], normal_max[2];
+
+	item_quad(const noice::validation::transform &box_transform) : m(box_transform)
+	{
+		corners[0] = {m.t.x, m.t.y};
+		corners[1] = {m.t.x + m.x.x, m.t.y + m.x.y};
+		corners[2] = {m.t.x + m.x.x + m.y.x, m.t.y + m.x.y + m.y.y};
+		corners[3] = {m.t.x + m.y.x, m.t.y + m.y.y};
+
+		min_x = max_x = corners[0].x;
+		min_y = max_y = corners[0].y;
+		for (int i = 1; i < 4; i++) {
+			min_x = lane_min(min_x, corners[i].x);
+			max_x = lane_max(max_x, corners[i].x);
+			min_y = lane_min(min_y, corners[i].y);
+			max_y = lane_max(max_y, corners[i].y);
+		}
+
+		normals[0] = {-m.x.y, m.x.x};
+		normals[1] = {-m.y.y, m.y.x};
+		for (int i = 0; i < 2; i++) {
+			const noice::validation::point &n = normals[i];
+			float a = m.t.x * n.x + m.t.y * n.y;
+			// The other edge is parallel to the normal axis, only its length projects
+			const noice::validation::point &e = i == 0 ? m.y : m.x;
+			float b = a + (e.x * n.x + e.y * n.y);
+			normal_min[i] = lane_min(a, b);
+			normal_max[i] = lane_max(a, b);
+		}
+	}
+};
+
+static bool quad_overlaps(const item_quad &quad, float x1, float x2, float y1, float y2)
+{
+	// Canvas axes
+	if (!(quad.min_x < x2 && quad.max_x > x1 && quad.min_y < y2 && quad.max_y > y1))
+		return false;
+
+	// Quad edge normals, project the region onto them
+	for (int i = 0; i < 2; i++) {
+		const noice::validation::point &n = quad.normals[i];
+		float r_min = lane_min(n.x * x1, n.x * x2) + lane_min(n.y * y1, n.y * y2);
+		float r_max = lane_max(n.x * x1, n.x * x2) + lane_max(n.y * y1, n.y * y2);
+		if (!(quad.normal_min[i] < r_max && quad.normal_max[i] > r_min))
+			return false;
+	}
+
+	return true;
+}
+
+// Area of the quad clipped to the region, Sutherland-Hodgman against the four region edges
+static float quad_overlap_area(const item_quad &quad, float x1, float x2, float y1, float y2)
+{
+	noice::validation::point buffers[2][8];
+	noice::validation::point *in = buffers[0], *out = buffers[1];
+	int count = 4;
+	for (int i = 0; i < 4; i++)
+		in[i] = quad.corners[i];
+
+	for (int edge = 0; edge < 4 && count > 0; edge++) {
+		auto distance = [edge, x1, x2, y1, y2](const noice::validation::point &p) {
+			switch (edge) {
+			case 0:
+				return p.x - x1;
+			case 1:
+				return x2 - p.x;
+			case 2:
+				return p.y - y1;
+			default:
+				return y2 - p.y;
+			}
+		};
+
+		int out_count = 0;
+		for (int i = 0; i < count; i++) {
+			const noice::validation::point &a = in[i];
+			const noice::validation::point &b = in[(i + 1) % count];
+			float da = distance(a), db = distance(b);
+
+			if (da >= 0.0f)
+				out[out_count++] = a;
+			if ((da >= 0.0f) != (db >= 0.0f)) {
+				float t = da / (da - db);
+				out[out_count++] = {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t};
+			}
+		}
+		std::swap(in, out);
+		count = out_count;
+	}
+
+	float area = 0.0f;
+	for (int i = 0; i < count; i++) {
+		const noice::validation::point &a = in[i];
+		const noice::validation::point &b = in[(i + 1) % count];
+		area += a.x * b.y - b.x * a.y;
+	}
+	return std::abs(area) * 0.5f;
+}
+
+static void region_bounds(const noice::validation::rect &region, float &x1, float &x2, float &y1, float &y2)
+{
+	x1 = std::min(region.x, region.x + region.w);
+	x2 = std::max(region.x, region.x + region.w);
+	y1 = std::min(region.y, region.y + region.h);
+	y2 = std::max(region.y, region.y + region.h);
+}
+
+bool noice::validation::item_in_region(const transform &m, const rect &region)
+{
+	float x1, x2, y1, y2;
+	region_bounds(region, x1, x2, y1, y2);
+	return quad_overlaps(item_quad(m), x1, x2, y1, y2);
+}
+
+float noice::validation::item_overlap_area(const transform &m, const rect &region)
+{
+	float x1, x2, y1, y2;
+	region_bounds(region, x1, x2, y1, y2);
+
+	item_quad quad(m);
+	if (!quad_overlaps(quad, x1, x2, y1, y2))
+		return 0.0f;
+	return quad_overlap_area(quad, x1, x2, y1, y2);
+}
+
+#pragma mark Batch kernel
+
+noice::validation::region_batch::region_batch(const std::vector<region> &regions) : count(regions.size())
+{
+	size_t padded = blocks() * BLOCK_SIZE;
+	for (auto *v : {&x1, &x2, &y1, &y2, &min_area})
+		v->assign(padded, 0.0f);
+
+	for (size_t i = 0; i < count; i++) {
+		region_bounds(regions[i].box, x1[i], x2[i], y1[i], y2[i]);
+		min_area[i] = regions[i].min_area;
+	}
+}
+
+static uint32_t block_mask(const noice::validation::region_batch &regions, size_t block)
+{
+	size_t remaining = regions.count - block * noice::validation::region_batch::BLOCK_SIZE;
+	if (remaining >= noice::validation::region_batch::BLOCK_SIZE)
+		return 0xff;
+	return (1u << remaining) - 1;
+}
+
+static uint32_t scalar_block(const item_quad &quad, const noice::validation::region_batch &regions, size_t offset)
+{
+	uint32_t mask = 0;
+	for (size_t i = 0; i < noice::validation::region_batch::BLOCK_SIZE; i++) {
+		size_t idx = offset + i;
+		if (quad_overlaps(quad, regions.x1[idx], regions.x2[idx], regions.y1[idx], regions.y2[idx]))
+			mask |= 1u << i;
+	}
+	return mask;
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define NOICE_KERNEL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define NOICE_TARGET_AVX2
+#else
+#define NOICE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define NOICE_KERNEL_X86 0
+#endif
+
+#if NOICE_KERNEL_X86
+
+// Lane-wise operations in the exact order of the scalar code so results stay identical
+struct sse2_ops {
+	typedef __m128 v;
+	static constexpr size_t width = 4;
+
+	static inline v load(const float *p) { return _mm_loadu_ps(p); }
+	static inline v set1(float f) { return _mm_set1_ps(f); }
+	static inline v add(v a, v b) { return _mm_add_ps(a, b); }
+	static inline v mul(v a, v b) { return _mm_mul_ps(a, b); }
+	static inline v min(v a, v b) { return _mm_min_ps(a, b); }
+	static inline v max(v a, v b) { return _mm_max_ps(a, b); }
+	static inline v gt(v a, v b) { return _mm_cmpgt_ps(a, b); }
+	static inline v lt(v a, v b) { return _mm_cmplt_ps(a, b); }
+	static inline v and_(v a, v b) { return _mm_and_ps(a, b); }
+	static inline uint32_t movemask(v a) { return (uint32_t)_mm_movemask_ps(a); }
+};
+
+struct avx2_ops {
+	typedef __m256 v;
+	static constexpr size_t width = 8;
+
+	NOICE_TARGET_AVX2 static inline v load(const float *p) { return _mm256_loadu_ps(p); }
+	NOICE_TARGET_AVX2 static inline v set1(float f) { return _mm256_set1_ps(f); }
+	NOICE_TARGET_AVX2 static inline v add(v a, v b) { return _mm256_add_ps(a, b); }
+	NOICE_TARGET_AVX2 static inline v mul(v a, v b) { return _mm256_mul_ps(a, b); }
+	NOICE_TARGET_AVX2 static inline v min(v a, v b) { return _mm256_min_ps(a, b); }
+	NOICE_TARGET_AVX2 static inline v max(v a, v b) { return _mm256_max_ps(a, b); }
+	NOICE_TARGET_AVX2 static inline v gt(v a, v b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	NOICE_TARGET_AVX2 static inline v lt(v a, v b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	NOICE_TARGET_AVX2 static inline v and_(v a, v b) { return _mm256_and_ps(a, b); }
+	NOICE_TARGET_AVX2 static inline uint32_t movemask(v a) { return (uint32_t)_mm256_movemask_ps(a); }
+};
+
+#define KERNEL_BODY(O)                                                                                                        \
+	typedef typename O::v v;                                                                                              \
+	const v x1 = O::load(&regions.x1[offset]), x2 = O::load(&regions.x2[offset]);                                          \
+	const v y1 = O::load(&regions.y1[offset]), y2 = O::load(&regions.y2[offset]);                                          \
+                                                                                                                              \
+	v hit = O::and_(O::lt(O::set1(quad.min_x), x2), O::gt(O::set1(quad.max_x), x1));                                      \
+	hit = O::and_(hit, O::and_(O::lt(O::set1(quad.min_y), y2), O::gt(O::set1(quad.max_y), y1)));                          \
+                                                                                                                              \
+	for (int i = 0; i < 2; i++) {                                                                                         \
+		const v nx = O::set1(quad.normals[i].x), ny = O::set1(quad.normals[i].y);                                     \
+		const v ax = O::mul(nx, x1), bx = O::mul(nx, x2), ay = O::mul(ny, y1), by = O::mul(ny, y2);                   \
+		const v r_min = O::add(O::min(ax, bx), O::min(ay, by));                                                        \
+		const v r_max = O::add(O::max(ax, bx), O::max(ay, by));                                                        \
+		hit = O::and_(hit, O::and_(O::lt(O::set1(quad.normal_min[i]), r_max), O::gt(O::set1(quad.normal_max[i]), r_min))); \
+	}                                                                                                                     \
+	return O::movemask(hit);
+
+static uint32_t sse2_lanes(const item_quad &quad, const noice::validation::region_batch &regions, size_t offset)
+{
+	KERNEL_BODY(sse2_ops)
+}
+
+NOICE_TARGET_AVX2 static uint32_t avx2_lanes(const item_quad &quad, const noice::validation::region_batch &regions, size_t offset)
+{
+	KERNEL_BODY(avx2_ops)
+}
+
+#endif
+
+noice::validation::kernel noice::validation::detect_kernel()
+{
+#if NOICE_KERNEL_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] >= 7) {
+		__cpuidex(info, 7, 0);
+		bool avx2 = (info[1] & (1 << 5)) != 0;
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		if (avx2 && osxsave && (_xgetbv(0) & 0x6) == 0x6)
+			return kernel::avx2;
+	}
+#else
+	if (__builtin_cpu_supports("avx2"))
+		return kernel::avx2;
+#endif
+	return kernel::sse2;
+#else
+	return kernel::scalar;
+#endif
+}
+
+const char *noice::validation::kernel_name(kernel k)
+{
+	switch (k) {
+	case kernel::sse2:
+		return "sse2";
+	case kernel::avx2:
+		return "avx2";
+	default:
+		return "scalar";
+	}
+}
+
+static uint32_t quad_in_region_block(const item_quad &quad, const noice::validation::region_batch &regions, size_t block,
+				     noice::validation::kernel k)
+{
+	using noice::validation::kernel;
+	using noice::validation::region_batch;
+
+	size_t offset = block * region_batch::BLOCK_SIZE;
+	uint32_t mask = 0;
+
+	switch (k) {
+#if NOICE_KERNEL_X86
+	case kernel::avx2:
+		mask = avx2_lanes(quad, regions, offset);
+		break;
+	case kernel::sse2:
+		mask = sse2_lanes(quad, regions, offset) | (sse2_lanes(quad, regions, offset + 4) << 4);
+		break;
+#endif
+	default:
+		mask = scalar_block(quad, regions, offset);
+		break;
+	}
+
+	// Padding lanes
+	return mask & block_mask(regions, block);
+}
+
+uint32_t noice::validation::item_in_region_block(const transform &box_transform, const region_batch &regions, size_t block, kernel k)
+{
+	return quad_in_region_block(item_quad(box_transform), regions, block, k);
+}
+
+int noice::validation::canvas_coverage(point pos, point size, float rot, float canvas_width, float canvas_height)
+{
+	if (rot != 0.0f) {
+		float ang = rot * (float)(M_PI / 180.0);
+		float sin_a = sinf(ang);
+		float cos_a = cosf(ang);
+
+		float bb_h = size.x * fabsf(sin_a) + size.y * fabsf(cos_a);
+		float bb_w = size.x * fabsf(cos_a) + size.y * fabsf(sin_a);
+
+		float cx = pos.x + size.x / 2 * cos_a - size.y / 2 * sin_a;
+		float cy = pos.y + size.x / 2 * sin_a + size.y / 2 * cos_a;
+
+		pos = {cx - bb_w / 2, cy - bb_h / 2};
+		size = {bb_w, bb_h};
+	}
+
+	// Flipped
+	if (size.x < 0) {
+		size.x = fabsf(size.x);
+		pos.x -= size.x;
+	}
+	if (size.y < 0) {
+		size.y = fabsf(size.y);
+		pos.y -= size.y;
+	}
+
+	// Clamp outside canvas
+	if (pos.x < 0.0f) {
+		size.x += pos.x;
+		pos.x = 0.0f;
+	}
+	if (pos.y < 0.0f) {
+		size.y += pos.y;
+		pos.y = 0.0f;
+	}
+	if (size.x > canvas_width)
+		size.x = canvas_width;
+	if (size.y > canvas_height)
+		size.y = canvas_height;
+
+	float dist_x = (fminf(size.x, canvas_width) - fmaxf(size.x + pos.x, canvas_width)) + canvas_width;
+	float dist_y = (fminf(size.y, canvas_height) - fmaxf(size.y + pos.y, canvas_height)) + canvas_height;
+	return (int)((dist_x * dist_y) / (canvas_width * canvas_height) * 100.0f);
+}
+
+std::shared_ptr<const noice::validation::result> noice::validation::validate(std::shared_ptr<const scene_snapshot> snapshot,
+									     std::shared_ptr<const std::vector<region>> regions,
+									     const options &opts, uint64_t frame_time)
+{
+	auto res = std::make_shared<result>();
+	res->snapshot = snapshot;
+	res->regions = regions;
+	res->opts = opts;
+	res->frame_time = frame_time;
+
+	if (!regions)
+		return res;
+	res->region_hits.assign(regions->size(), 0);
+
+	if (!snapshot)
+		return res;
+
+	static const kernel active_kernel = detect_kernel();
+	region_batch batch(*regions);
+
+	for (size_t index = 0; index < snapshot->items.size(); index++) {
+		const item &it = snapshot->items[index];
+
+		if (it.main_video)
+			continue;
+		if (it.coverage > 98)
+			continue;
+
+		int hits = 0;
+		uint64_t region_mask = 0;
+		item_quad quad(it.box_transform);
+		for (size_t block = 0; block < batch.blocks(); block++) {
+			uint32_t mask = quad_in_region_block(quad, batch, block, active_kernel);
+			for (size_t i = block * region_batch::BLOCK_SIZE; mask != 0; mask >>= 1, i++) {
+				if (!(mask & 1))
+					continue;
+				// Only pay for clipping where a threshold is configured
+				if (batch.min_area[i] > 0.0f &&
+				    quad_overlap_area(quad, batch.x1[i], batch.x2[i], batch.y1[i], batch.y2[i]) < batch.min_area[i])
+					continue;
+				hits++;
+				res->region_hits[i]++;
+				if (i < MAX_TRACKED_REGIONS)
+					region_mask |= uint64_t(1) << i;
+			}
+		}
+
+		if (region_mask != 0)
+			res->occlusions.push_back({it.source_id, region_mask});
+
+		if (opts.debug_sources == false && hits == 0)
+			continue;
+
+		res->items.push_back({index, hits != 0, region_mask});
+	}
+
+	// A source can be shown by several items
+	std::sort(res->occlusions.begin(), res->occlusions.end(),
+		  [](const occlusion &a, const occlusion &b) { return a.source_id < b.source_id; });
+	size_t merged = 0;
+	for (size_t i = 0; i < res->occlusions.size(); i++) {
+		if (merged > 0 && res->occlusions[merged - 1].source_id == res->occlusions[i].source_id)
+			res->occlusions[merged - 1].region_mask |= res->occlusions[i].region_mask;
+		else
+			res->occlusions[merged++] = res->occlusions[i];
+	}
+	res->occlusions.resize(merged);
+	return res;
+}
+
+#pragma mark Occlusion tracking
+
+void noice::validation::occlusion_intervals::apply(const occlusion_event &event)
+{
+	uint64_t key = (uint64_t(event.source_id) << 32) | event.region_id;
+
+	if (event.started) {
+		open_interval &open = _open[key];
+		if (open.count++ == 0)
+			open.start = event.time;
+		return;
+	}
+
+	auto it = _open.find(key);
+	if (it == _open.end())
+		return;
+	if (--it->second.count > 0)
+		return;
+
+	if (_closed.size() < _closed_limit)
+		_closed.push_back({event.source_id, event.region_id, it->second.start, event.time});
+	else
+		_dropped++;
+	_open.erase(it);
+}
+
+void noice::validation::occlusion_intervals::collect(std::vector<occlusion_interval> &out)
+{
+	out.insert(out.end(), _closed.begin(), _closed.end());
+	_closed.clear();
+
+	for (auto &it : _open)
+		out.push_back({uint32_t(it.first >> 32), uint32_t(it.first), it.second.start, 0});
+}
+
+void noice::validation::occlusion_intervals::clear_closed()
+{
+	_closed.clear();
+}
+
+void noice::validation::occlusion_stats::reset(uint64_t time)
+{
+	_start = time;
+	for (auto it = _pairs.begin(); it != _pairs.end();) {
+		pair_stats &pair = it->second;
+		if (pair.count == 0) {
+			it = _pairs.erase(it);
+			continue;
+		}
+		pair.start = time;
+		pair.total = 0;
+		pair.longest = 0;
+		++it;
+	}
+}
+
+void noice::validation::occlusion_stats::apply(const occlusion_event &event)
+{
+	if (_start == 0)
+		_start = event.time;
+	// Events queued before a reset are not part of the observed time
+	uint64_t time = std::max(event.time, _start);
+	uint64_t key = (uint64_t(event.source_id) << 32) | event.region_id;
+
+	if (event.started) {
+		pair_stats &pair = _pairs[key];
+		if (pair.count++ == 0)
+			pair.start = time;
+		return;
+	}
+
+	auto it = _pairs.find(key);
+	if (it == _pairs.end() || it->second.count == 0)
+		return;
+	pair_stats &pair = it->second;
+	if (--pair.count > 0)
+		return;
+
+	uint64_t duration = time - pair.start;
+	pair.total += duration;
+	pair.longest = std::max(pair.longest, duration);
+}
+
+uint64_t noice::validation::occlusion_stats::summarize(uint64_t now, std::vector<occlusion_summary> &out, size_t limit) const
+{
+	uint64_t observed = _start != 0 && now > _start ? now - _start : 0;
+
+	size_t first = out.size();
+	for (auto &it : _pairs) {
+		const pair_stats &pair = it.second;
+		bool active = pair.count > 0;
+		uint64_t current = active && now > pair.start ? now - pair.start : 0;
+
+		occlusion_summary summary;
+		summary.source_id = uint32_t(it.first >> 32);
+		summary.region_id = uint32_t(it.first);
+		summary.total = pair.total + current;
+		summary.longest = std::max(pair.longest, current);
+		summary.fraction = observed ? std::min(1.0f, float(double(summary.total) / double(observed))) : 0.0f;
+		summary.active = active;
+		out.push_back(summary);
+	}
+
+	auto begin = out.begin() + first;
+	auto by_total = [](const occlusion_summary &a, const occlusion_summary &b) { return a.total > b.total; };
+	if (out.size() - first > limit) {
+		std::partial_sort(begin, begin + limit, out.end(), by_total);
+		out.resize(first + limit);
+	} else {
+		std::sort(begin, out.end(), by_total);
+	}
+	return observed;
+}
+
+void noice::validation::occlusion_tracker::diff(const std::vector<occlusion> &hits, uint64_t time, const sink_t &sink)
+{
+	_scratch.clear();
+
+	size_t a = 0, b = 0;
+	while (a < _reported.size() || b < hits.size()) {
+		uint32_t source_id;
+		uint64_t before = 0, after = 0;
+		if (b == hits.size() || (a < _reported.size() && _reported[a].source_id < hits[b].source_id)) {
+			source_id = _reported[a].source_id;
+			before = _reported[a++].region_mask;
+		} else if (a == _reported.size() || hits[b].source_id < _reported[a].source_id) {
+			source_id = hits[b].source_id;
+			after = hits[b++].region_mask;
+		} else {
+			source_id = hits[b].source_id;
+			before = _reported[a++].region_mask;
+			after = hits[b++].region_mask;
+		}
+
+		uint64_t reported = before;
+		for (uint64_t changed = before ^ after; changed != 0; changed &= changed - 1) {
+			uint64_t bit = changed & (~changed + 1);
+			size_t index = 0;
+			while ((uint64_t(1) << index) != bit)
+				index++;
+
+			occlusion_event event{time, source_id, (*_regions)[index].id, (after & bit) != 0};
+			if (sink(event))
+				reported ^= bit;
+			else
+				_pending = true;
+		}
+
+		if (reported != 0)
+			_scratch.push_back({source_id, reported});
+	}
+
+	std::swap(_reported, _scratch);
+}
+
+void noice::validation::occlusion_tracker::update(const std::vector<occlusion> &hits, std::shared_ptr<const std::vector<region>> regions,
+						  uint64_t time, const sink_t &sink)
+{
+	_pending = false;
+
+	// Bits refer to the previous regions until everything reported against them has stopped
+	if (regions != _regions) {
+		if (!_reported.empty()) {
+			diff({}, time, sink);
+			if (_pending)
+				return;
+		}
+		_regions = regions;
+	}
+
+	if (_regions)
+		diff(hits, time, sink);
+}
+
+noice::validation::engine::~engine()
+{
+	// Let the tracker report everything still occluded as stopped
+	if (_state->sink)
+		submit(nullptr, nullptr, options(), _state->submitted_time);
+}
+
+noice::validation::engine::engine(executor_t executor, occlusion_tracker::sink_t sink)
+	: _executor(executor), _state(std::make_shared<state>())
+{
+	_state->sink = sink;
+}
+
+void noice::validation::engine::run(std::shared_ptr<state> st)
+{
+	std::unique_lock<std::mutex> lock(st->lock);
+	while (st->has_pending) {
+		auto snapshot = std::move(st->pending_snapshot);
+		auto regions = std::move(st->pending_regions);
+		options opts = st->pending_opts;
+		uint64_t time = st->pending_time;
+		st->has_pending = false;
+
+		lock.unlock();
+		auto res = validate(snapshot, regions, opts, time);
+		bool tracker_pending = false;
+		if (st->sink) {
+			st->tracker.update(res->occlusions, regions, time, st->sink);
+			tracker_pending = st->tracker.pending();
+		}
+		lock.lock();
+
+		st->tracker_pending = tracker_pending;
+
+		st->published = res;
+	}
+	st->busy = false;
+}
+
+void noice::validation::engine::submit(std::shared_ptr<const scene_snapshot> snapshot, std::shared_ptr<const std::vector<region>> regions,
+				       const options &opts, uint64_t frame_time)
+{
+	std::shared_ptr<state> st = _state;
+	{
+		std::unique_lock<std::mutex> lock(st->lock);
+		// Snapshots and regions are immutable, the same inputs give the same result. Unless
+		// occlusion events are still waiting to be delivered.
+		st->submitted_time = frame_time;
+		if (st->has_submitted && st->submitted_snapshot == snapshot && st->submitted_regions == regions &&
+		    st->submitted_opts.debug_sources == opts.debug_sources && !st->tracker_pending)
+			return;
+		st->submitted_snapshot = snapshot;
+		st->submitted_regions = regions;
+		st->submitted_opts = opts;
+		st->has_submitted = true;
+
+		st->pending_snapshot = std::move(snapshot);
+		st->pending_regions = std::move(regions);
+		st->pending_opts = opts;
+		st->pending_time = frame_time;
+		st->has_pending = true;
+
+		// The running job picks up the new submission when it's done
+		if (st->busy)
+			return;
+		st->busy = true;
+	}
+
+	if (_executor) {
+		_executor([st]() { run(st); });
+	} else {
+		run(st);
+	}
+}
+
+std::shared_ptr<const noice::validation::result> noice::validation::engine::latest()
+{
+	std::unique_lock<std::mutex> lock(_state->lock);
+	return _state->published;
+}
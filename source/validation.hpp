@@ -0,0 +1,329 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cinttypes>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Collision detection between scene items and game regions. Intentionally free of
+// libobs types so it can be driven headless with synthetic scenes.
+namespace noice::validation {
+
+struct point {
+	float x;
+	float y;
+};
+
+// 2D affine transform laid out like the x, y and t rows of an OBS matrix4,
+// points are transformed as row vectors: p' = p.x * x + p.y * y + t
+struct transform {
+	point x;
+	point y;
+	point t;
+
+	static transform identity() { return {{1.0f, 0.0f}, {0.0f, 1.0f}, {0.0f, 0.0f}}; }
+};
+
+struct rect {
+	float x;
+	float y;
+	float w;
+	float h;
+};
+
+// Applies a first and then b, same as matrix4_mul(&out, a, b)
+transform multiply(const transform &a, const transform &b);
+
+point apply(const transform &m, point p);
+
+bool invert(const transform &m, transform &out);
+
+struct region {
+	rect box;
+	// Minimum overlap in canvas pixels for an item to count as a hit, 0 accepts any overlap
+	float min_area;
+	// Stable identity reported in occlusion events
+	uint32_t id;
+};
+
+// Whether the unit box mapped by box_transform overlaps the region. Exact separating axis
+// test, edges merely touching do not count.
+bool item_in_region(const transform &box_transform, const rect &region);
+
+// Area of the unit box mapped by box_transform that lies inside the region
+float item_overlap_area(const transform &box_transform, const rect &region);
+
+// Region rects in structure-of-arrays form for the batch kernel, padded to full blocks
+struct region_batch {
+	static constexpr size_t BLOCK_SIZE = 8;
+
+	size_t count;
+	std::vector<float> x1, x2, y1, y2;
+	std::vector<float> min_area;
+
+	region_batch(const std::vector<region> &regions);
+
+	size_t blocks() const { return (count + BLOCK_SIZE - 1) / BLOCK_SIZE; }
+};
+
+enum class kernel {
+	scalar,
+	sse2,
+	avx2,
+};
+
+// Best kernel supported by the running CPU
+kernel detect_kernel();
+
+const char *kernel_name(kernel k);
+
+// Tests one item against a block of up to 8 regions, bit i of the result is region
+// block * 8 + i. Every kernel gives results identical to item_in_region, the minimum
+// overlap is not applied here.
+uint32_t item_in_region_block(const transform &box_transform, const region_batch &regions, size_t block, kernel k);
+
+// Percentage of the canvas covered by the axis aligned bounds of a (possibly rotated) item
+int canvas_coverage(point pos, point size, float rot, float canvas_width, float canvas_height);
+
+struct item {
+	// Stable identity of the source shown, reported in occlusion events
+	uint32_t source_id;
+
+	// Item box in canvas space, parent group included
+	transform box_transform;
+
+	// As drawn: group draw transform and the item box relative to it
+	transform parent_transform;
+	transform local_box_transform;
+	point box_scale;
+
+	// Percentage of the canvas covered, see canvas_coverage
+	int coverage;
+
+	bool main_video;
+};
+
+struct scene_snapshot {
+	// Video frame time the snapshot was taken at
+	uint64_t frame_time;
+	uint32_t canvas_width;
+	uint32_t canvas_height;
+	std::vector<item> items;
+
+	scene_snapshot() : frame_time(0), canvas_width(0), canvas_height(0) {}
+};
+
+struct options {
+	bool debug_sources;
+
+	options() : debug_sources(false) {}
+};
+
+// Only the first 64 regions of a game are tracked in occlusion masks
+static constexpr size_t MAX_TRACKED_REGIONS = 64;
+
+struct item_result {
+	size_t index;
+	bool collides;
+	// Bit i set when the item hits region i
+	uint64_t region_mask;
+};
+
+// Regions a source hits, merged over all items showing it
+struct occlusion {
+	uint32_t source_id;
+	uint64_t region_mask;
+};
+
+struct occlusion_event {
+	uint64_t time;
+	uint32_t source_id;
+	uint32_t region_id;
+	bool started;
+};
+
+struct result {
+	std::shared_ptr<const scene_snapshot> snapshot;
+	std::shared_ptr<const std::vector<region>> regions;
+	options opts;
+	uint64_t frame_time;
+
+	std::vector<int> region_hits;
+	// Items to hilight, either colliding or all validated ones with debug_sources
+	std::vector<item_result> items;
+	// Sorted by source id
+	std::vector<occlusion> occlusions;
+
+	result() : frame_time(0) {}
+};
+
+std::shared_ptr<const result> validate(std::shared_ptr<const scene_snapshot> snapshot, std::shared_ptr<const std::vector<region>> regions,
+				       const options &opts, uint64_t frame_time = 0);
+
+// Diffs consecutive hit sets and reports each (source, region) pair that started or stopped
+// being occluded. Events the sink refuses are kept pending and retried on the next update,
+// so the sink always sees a consistent sequence.
+class occlusion_tracker {
+public:
+	typedef std::function<bool(const occlusion_event &)> sink_t;
+
+private:
+	// State as reported to the sink, sorted by source id
+	std::vector<occlusion> _reported;
+	std::vector<occlusion> _scratch;
+	std::shared_ptr<const std::vector<region>> _regions;
+	bool _pending;
+
+	void diff(const std::vector<occlusion> &hits, uint64_t time, const sink_t &sink);
+
+public:
+	occlusion_tracker() : _pending(false) {}
+
+	void update(const std::vector<occlusion> &hits, std::shared_ptr<const std::vector<region>> regions, uint64_t time, const sink_t &sink);
+
+	bool pending() const { return _pending; }
+};
+
+struct occlusion_interval {
+	uint32_t source_id;
+	uint32_t region_id;
+	uint64_t start;
+	// 0 while the occlusion is still going on
+	uint64_t end;
+};
+
+// Folds occlusion events back into intervals. Starts and stops are counted per pair, so
+// several trackers reporting the same source and region nest into one interval.
+class occlusion_intervals {
+	struct open_interval {
+		uint32_t count;
+		uint64_t start;
+	};
+
+	std::unordered_map<uint64_t, open_interval> _open;
+	std::vector<occlusion_interval> _closed;
+	size_t _closed_limit;
+	size_t _dropped;
+
+public:
+	occlusion_intervals(size_t closed_limit = 1024) : _closed_limit(closed_limit), _dropped(0) {}
+
+	void apply(const occlusion_event &event);
+
+	// Moves out the intervals closed since the last call and appends the open ones
+	void collect(std::vector<occlusion_interval> &out);
+
+	void clear_closed();
+
+	// Closed intervals discarded because nobody collected them in time
+	size_t dropped() const { return _dropped; }
+};
+
+struct occlusion_summary {
+	uint32_t source_id;
+	uint32_t region_id;
+	// Nanoseconds, an ongoing occlusion counts up to the summary time
+	uint64_t total;
+	uint64_t longest;
+	// Share of the observed time spent occluded
+	float fraction;
+	bool active;
+};
+
+// Time weighted occlusion statistics per source and region, accumulated from occlusion
+// events so the cost follows the number of changes rather than the frame rate. Nesting
+// works like in occlusion_intervals.
+class occlusion_stats {
+	struct pair_stats {
+		uint32_t count;
+		uint64_t start;
+		uint64_t total;
+		uint64_t longest;
+	};
+
+	std::unordered_map<uint64_t, pair_stats> _pairs;
+	// Start of the observed time, 0 until the first event or reset
+	uint64_t _start;
+
+public:
+	occlusion_stats() : _start(0) {}
+
+	// Starts observing from time, ongoing occlusions carry over as if they started then
+	void reset(uint64_t time);
+
+	void apply(const occlusion_event &event);
+
+	// Pairs ever occluded since the reset, longest total first, at most limit entries.
+	// Returns the observed time.
+	uint64_t summarize(uint64_t now, std::vector<occlusion_summary> &out, size_t limit = SIZE_MAX) const;
+};
+
+// Runs validation on the given executor and publishes the latest result. Submissions made
+// while a validation is in flight are coalesced, only the newest one gets processed, and
+// repeating the previous submission is a no-op.
+class engine {
+public:
+	typedef std::function<void(std::function<void()>)> executor_t;
+
+private:
+	struct state {
+		std::mutex lock;
+		bool busy;
+		bool has_pending;
+		std::shared_ptr<const scene_snapshot> pending_snapshot;
+		std::shared_ptr<const std::vector<region>> pending_regions;
+		options pending_opts;
+		uint64_t pending_time;
+		std::shared_ptr<const result> published;
+
+		// Only touched by the running job
+		occlusion_tracker tracker;
+		occlusion_tracker::sink_t sink;
+		bool tracker_pending;
+
+		// Last accepted submission, repeats of it are dropped
+		bool has_submitted;
+		std::shared_ptr<const scene_snapshot> submitted_snapshot;
+		std::shared_ptr<const std::vector<region>> submitted_regions;
+		options submitted_opts;
+		uint64_t submitted_time;
+
+		state() : busy(false), has_pending(false), pending_time(0), tracker_pending(false), has_submitted(false), submitted_time(0) {}
+	};
+
+	executor_t _executor;
+	std::shared_ptr<state> _state;
+
+	static void run(std::shared_ptr<state> state);
+
+public:
+	~engine();
+	// Without an executor validation runs synchronously in submit(). Occlusion changes are
+	// passed to the sink from the executor, one job at a time.
+	engine(executor_t executor = nullptr, occlusion_tracker::sink_t sink = nullptr);
+
+	void submit(std::shared_ptr<const scene_snapshot> snapshot, std::shared_ptr<const std::vector<region>> regions, const options &opts,
+		    uint64_t frame_time);
+
+	std::shared_ptr<const result> latest();
+};
+
+} // namespace noice::validation
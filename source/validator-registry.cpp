@@ -0,0 +1,295 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "validator-registry.hpp"
+#include "common.hpp"
+#include <algorithm>
+#include <obs-module.h>
+
+// libobs doesn't allow groups in groups, anything deeper is a cycle we must not follow
+static constexpr size_t MAX_GROUP_DEPTH = 4;
+
+noice::source::validator_registry::validator_registry() : _changes(0) {}
+
+noice::source::validator_registry::~validator_registry()
+{
+	std::vector<obs_source_t *> scenes;
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		scenes.assign(_connected.begin(), _connected.end());
+		_connected.clear();
+		_scenes.clear();
+		_validators.clear();
+	}
+
+	for (obs_source_t *scene : scenes)
+		disconnect_scene(scene);
+}
+
+#pragma mark Signals
+
+void noice::source::validator_registry::scene_item_add(void *param, calldata_t *data)
+{
+	auto self = reinterpret_cast<noice::source::validator_registry *>(param);
+	obs_scene_t *scene = (obs_scene_t *)calldata_ptr(data, "scene");
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(data, "item");
+
+	if (obs_sceneitem_is_group(item)) {
+		obs_source_t *group = obs_scene_get_source(obs_sceneitem_group_get_scene(item));
+		{
+			std::unique_lock<std::mutex> lock(self->_lock);
+			self->_changes++;
+			auto it = self->_scenes.find(obs_scene_get_source(scene));
+			if (it != self->_scenes.end())
+				it->second.groups.push_back(group);
+		}
+		self->scan_scene(group);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(self->_lock);
+	self->_changes++;
+	if (self->_validators.count(obs_sceneitem_get_source(item)) == 0)
+		return;
+	auto it = self->_scenes.find(obs_scene_get_source(scene));
+	if (it != self->_scenes.end())
+		it->second.validators.push_back(item);
+}
+
+void noice::source::validator_registry::scene_item_remove(void *param, calldata_t *data)
+{
+	auto self = reinterpret_cast<noice::source::validator_registry *>(param);
+	obs_scene_t *scene = (obs_scene_t *)calldata_ptr(data, "scene");
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(data, "item");
+
+	// May be emitted with the scene locked, only touch our own state here
+	std::unique_lock<std::mutex> lock(self->_lock);
+	self->_changes++;
+	auto it = self->_scenes.find(obs_scene_get_source(scene));
+	if (it == self->_scenes.end())
+		return;
+
+	scene_entry &entry = it->second;
+	entry.validators.erase(std::remove(entry.validators.begin(), entry.validators.end(), item), entry.validators.end());
+	if (obs_sceneitem_is_group(item)) {
+		obs_source_t *group = obs_scene_get_source(obs_sceneitem_group_get_scene(item));
+		entry.groups.erase(std::remove(entry.groups.begin(), entry.groups.end(), group), entry.groups.end());
+	}
+}
+
+void noice::source::validator_registry::scene_loaded(void *param, calldata_t *data)
+{
+	auto self = reinterpret_cast<noice::source::validator_registry *>(param);
+	obs_source_t *scene = (obs_source_t *)calldata_ptr(data, "source");
+
+	// Loading adds the saved items without item_add signals
+	self->scan_scene(scene);
+}
+
+void noice::source::validator_registry::scene_destroyed(void *param, calldata_t *data)
+{
+	auto self = reinterpret_cast<noice::source::validator_registry *>(param);
+	obs_source_t *scene = (obs_source_t *)calldata_ptr(data, "source");
+
+	std::unique_lock<std::mutex> lock(self->_lock);
+	self->_changes++;
+	self->_connected.erase(scene);
+	self->_scenes.erase(scene);
+	for (auto &it : self->_scenes) {
+		std::vector<obs_source_t *> &groups = it.second.groups;
+		groups.erase(std::remove(groups.begin(), groups.end(), scene), groups.end());
+	}
+}
+
+void noice::source::validator_registry::connect_scene(obs_source_t *scene)
+{
+	signal_handler_t *sh = obs_source_get_signal_handler(scene);
+	signal_handler_connect(sh, "item_add", scene_item_add, this);
+	signal_handler_connect(sh, "item_remove", scene_item_remove, this);
+	signal_handler_connect(sh, "load", scene_loaded, this);
+	signal_handler_connect(sh, "destroy", scene_destroyed, this);
+}
+
+void noice::source::validator_registry::disconnect_scene(obs_source_t *scene)
+{
+	signal_handler_t *sh = obs_source_get_signal_handler(scene);
+	signal_handler_disconnect(sh, "item_add", scene_item_add, this);
+	signal_handler_disconnect(sh, "item_remove", scene_item_remove, this);
+	signal_handler_disconnect(sh, "load", scene_loaded, this);
+	signal_handler_disconnect(sh, "destroy", scene_destroyed, this);
+}
+
+#pragma mark Scenes
+
+void noice::source::validator_registry::scan_scene(obs_source_t *scene)
+{
+	obs_scene_t *obs_scene = obs_group_or_scene_from_source(scene);
+	if (!obs_scene)
+		return;
+
+	bool connect;
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		connect = _connected.insert(scene).second;
+	}
+	if (connect)
+		connect_scene(scene);
+
+	struct scan_param {
+		std::vector<obs_sceneitem_t *> items;
+		std::vector<obs_source_t *> groups;
+	};
+
+	auto enum_item = [](obs_scene_t *, obs_sceneitem_t *item, void *data) {
+		scan_param *p = reinterpret_cast<scan_param *>(data);
+		if (obs_sceneitem_is_group(item))
+			p->groups.push_back(obs_scene_get_source(obs_sceneitem_group_get_scene(item)));
+		else
+			p->items.push_back(item);
+		return true;
+	};
+
+	// Items are only safe to keep once the item_remove signal can reach them, start over
+	// when anything changed while enumerating outside our lock
+	scan_param param;
+	for (;;) {
+		uint64_t changes;
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			changes = _changes;
+		}
+
+		param.items.clear();
+		param.groups.clear();
+		obs_scene_enum_items(obs_scene, enum_item, &param);
+
+		std::unique_lock<std::mutex> lock(_lock);
+		if (changes != _changes)
+			continue;
+		if (_connected.count(scene) == 0)
+			return;
+
+		scene_entry &entry = _scenes[scene];
+		entry.validators.clear();
+		for (obs_sceneitem_t *item : param.items) {
+			if (_validators.count(obs_sceneitem_get_source(item)))
+				entry.validators.push_back(item);
+		}
+		entry.groups = param.groups;
+		break;
+	}
+
+	for (obs_source_t *group : param.groups)
+		scan_scene(group);
+}
+
+void noice::source::validator_registry::collect_items(obs_source_t *scene, std::vector<obs_sceneitem_t *> &out, size_t depth)
+{
+	auto it = _scenes.find(scene);
+	if (it == _scenes.end() || depth > MAX_GROUP_DEPTH)
+		return;
+
+	for (obs_sceneitem_t *item : it->second.validators) {
+		obs_sceneitem_addref(item);
+		out.push_back(item);
+	}
+	for (obs_source_t *group : it->second.groups)
+		collect_items(group, out, depth + 1);
+}
+
+#pragma mark Lookups
+
+void noice::source::validator_registry::add(obs_source_t *source, validator_instance *instance)
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	_validators[source] = instance;
+}
+
+void noice::source::validator_registry::remove(obs_source_t *source)
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	_validators.erase(source);
+	for (auto &it : _scenes) {
+		std::vector<obs_sceneitem_t *> &items = it.second.validators;
+		items.erase(std::remove_if(items.begin(), items.end(),
+					   [source](obs_sceneitem_t *item) { return obs_sceneitem_get_source(item) == source; }),
+			    items.end());
+	}
+}
+
+bool noice::source::validator_registry::scene_has_validator(obs_source_t *scene)
+{
+	bool known;
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		known = _connected.count(scene) != 0;
+	}
+	if (!known)
+		scan_scene(scene);
+
+	std::unique_lock<std::mutex> lock(_lock);
+	auto it = _scenes.find(scene);
+	return it != _scenes.end() && !it->second.validators.empty();
+}
+
+std::vector<obs_sceneitem_t *> noice::source::validator_registry::validator_items(obs_source_t *scene)
+{
+	bool known;
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		known = _connected.count(scene) != 0;
+	}
+	if (!known)
+		scan_scene(scene);
+
+	std::vector<obs_sceneitem_t *> items;
+	std::unique_lock<std::mutex> lock(_lock);
+	collect_items(scene, items, 0);
+	return items;
+}
+
+std::vector<obs_source_t *> noice::source::validator_registry::validators()
+{
+	std::vector<obs_source_t *> sources;
+	std::unique_lock<std::mutex> lock(_lock);
+	sources.reserve(_validators.size());
+	for (auto &it : _validators) {
+		// Null while the source is being destroyed
+		obs_source_t *source = obs_source_get_ref(it.first);
+		if (source)
+			sources.push_back(source);
+	}
+	return sources;
+}
+
+#pragma mark Singleton
+
+std::shared_ptr<noice::source::validator_registry> noice::source::validator_registry::_instance = nullptr;
+
+void noice::source::validator_registry::initialize()
+{
+	if (!noice::source::validator_registry::_instance)
+		noice::source::validator_registry::_instance = std::make_shared<noice::source::validator_registry>();
+}
+
+void noice::source::validator_registry::finalize()
+{
+	noice::source::validator_registry::_instance.reset();
+}
+
+std::shared_ptr<noice::source::validator_registry> noice::source::validator_registry::instance()
+{
+	return noice::source::validator_registry::_instance;
+}
@@ -0,0 +1,92 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <obs.h>
+
+namespace noice::source {
+class validator_instance;
+
+// Live validator instances and the scene items showing them, so callers can find
+// validators without enumerating every scene item and comparing source ids. Validators
+// register themselves on create/destroy, scenes are scanned once on first lookup and then
+// kept up to date through their item_add/item_remove/load signals.
+class validator_registry {
+private:
+	struct scene_entry {
+		// Items directly in the scene showing a validator
+		std::vector<obs_sceneitem_t *> validators;
+		// Scene sources of groups directly in the scene
+		std::vector<obs_source_t *> groups;
+	};
+
+	std::mutex _lock;
+	std::unordered_map<obs_source_t *, validator_instance *> _validators;
+	std::unordered_map<obs_source_t *, scene_entry> _scenes;
+	// Scenes and groups with connected item signals
+	std::unordered_set<obs_source_t *> _connected;
+	// Bumped by every item change, scans enumerating outside the lock retry when it moved
+	uint64_t _changes;
+
+public:
+	virtual ~validator_registry();
+	validator_registry();
+
+private:
+	static void scene_item_add(void *param, calldata_t *data);
+	static void scene_item_remove(void *param, calldata_t *data);
+	static void scene_loaded(void *param, calldata_t *data);
+	static void scene_destroyed(void *param, calldata_t *data);
+
+	void connect_scene(obs_source_t *scene);
+
+	void disconnect_scene(obs_source_t *scene);
+
+	// Connects the scene if needed and rebuilds its entry, groups in it included
+	void scan_scene(obs_source_t *scene);
+
+	void collect_items(obs_source_t *scene, std::vector<obs_sceneitem_t *> &out, size_t depth);
+
+public:
+	void add(obs_source_t *source, validator_instance *instance);
+
+	void remove(obs_source_t *source);
+
+	// Whether a validator is directly in the scene
+	bool scene_has_validator(obs_source_t *scene);
+
+	// Validator items in the scene and its groups, in no particular order. Items are
+	// referenced, the caller releases them.
+	std::vector<obs_sceneitem_t *> validator_items(obs_source_t *scene);
+
+	// References to all live validator sources, the caller releases them
+	std::vector<obs_source_t *> validators();
+
+private /* Singleton */:
+	static std::shared_ptr<noice::source::validator_registry> _instance;
+
+public /* Singleton */:
+	static void initialize();
+
+	static void finalize();
+
+	static std::shared_ptr<noice::source::validator_registry> instance();
+};
+} // namespace noice::source
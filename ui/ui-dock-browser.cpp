@@ -0,0 +1,153 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "ui-dock-browser.hpp"
+#include "noice-bridge.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <util/platform.h>
+#include "common.hpp"
+
+constexpr std::string_view CFG_BROWSER_UNLOAD_TIMEOUT = "dock.browser.unload_timeout";
+
+static constexpr int64_t DEFAULT_UNLOAD_TIMEOUT_S = 300;
+
+static std::vector<noice::ui::dock::browser_host *> hosts;
+
+static int64_t unload_timeout_ms()
+{
+	auto cfg = noice::get_bridge()->configuration_instance();
+	if (!cfg)
+		return DEFAULT_UNLOAD_TIMEOUT_S * 1000;
+
+	auto data = cfg->get();
+	obs_data_set_default_int(data.get(), CFG_BROWSER_UNLOAD_TIMEOUT.data(), DEFAULT_UNLOAD_TIMEOUT_S);
+	int64_t seconds = obs_data_get_int(data.get(), CFG_BROWSER_UNLOAD_TIMEOUT.data());
+	return seconds < 0 ? -1 : seconds * 1000;
+}
+
+noice::ui::dock::browser_host::browser_host(QWidget *parent, const QString &name)
+	: QWidget(parent),
+	  _name(name),
+	  _layout(new QHBoxLayout(this)),
+	  _browser(nullptr),
+	  _url(),
+	  _shown(false),
+	  _unload_timer(this),
+	  _created(0),
+	  _loaded_since(0),
+	  _loaded_total(0)
+{
+	_layout->setContentsMargins(0, 0, 0, 0);
+	setMinimumSize(300, 170);
+
+	_unload_timer.setSingleShot(true);
+	connect(&_unload_timer, &QTimer::timeout, this, [this]() {
+		if (!_shown)
+			destroy_browser();
+	});
+
+	hosts.push_back(this);
+}
+
+noice::ui::dock::browser_host::~browser_host()
+{
+	hosts.erase(std::remove(hosts.begin(), hosts.end(), this), hosts.end());
+	destroy_browser();
+}
+
+void noice::ui::dock::browser_host::set_url(const std::string &url)
+{
+	_url = url;
+	if (_browser)
+		_browser->setURL(_url);
+}
+
+void noice::ui::dock::browser_host::set_shown(bool shown)
+{
+	_shown = shown;
+
+	if (shown) {
+		_unload_timer.stop();
+		if (!_browser)
+			create_browser();
+		return;
+	}
+
+	if (!_browser)
+		return;
+
+	int64_t timeout = unload_timeout_ms();
+	if (timeout >= 0)
+		_unload_timer.start((int)std::min<int64_t>(timeout, std::numeric_limits<int>::max()));
+}
+
+void noice::ui::dock::browser_host::create_browser()
+{
+	try {
+		_browser = obs::browser::instance()->create_widget(this, _url);
+	} catch (const std::exception &ex) {
+		DLOG_ERROR("Failed to create browser for %s: %s", _name.toUtf8().constData(), ex.what());
+		return;
+	}
+	if (!_browser)
+		return;
+
+	_layout->addWidget(_browser);
+	connect(_browser, &QCefWidget::urlChanged, this, [this](const QString &url) { _url = url.toStdString(); });
+
+	_created++;
+	_loaded_since = os_gettime_ns();
+	DLOG_INFO("Created browser for %s", _name.toUtf8().constData());
+}
+
+void noice::ui::dock::browser_host::destroy_browser()
+{
+	_unload_timer.stop();
+	if (!_browser)
+		return;
+
+	_layout->removeWidget(_browser);
+	_browser->closeBrowser();
+	_browser->deleteLater();
+	_browser = nullptr;
+
+	_loaded_total += os_gettime_ns() - _loaded_since;
+	_loaded_since = 0;
+	DLOG_INFO("Unloaded browser for %s", _name.toUtf8().constData());
+}
+
+noice::ui::dock::browser_stat noice::ui::dock::browser_host::stat() const
+{
+	browser_stat stat;
+	stat.name = _name;
+	stat.loaded = _browser != nullptr;
+	stat.shown = _shown;
+	stat.unload_in_ms = _unload_timer.isActive() ? _unload_timer.remainingTime() : -1;
+	stat.created = _created;
+	stat.loaded_ms = (_loaded_total + (_loaded_since ? os_gettime_ns() - _loaded_since : 0)) / 1000000;
+	return stat;
+}
+
+std::vector<noice::ui::dock::browser_stat> noice::ui::dock::browser_host::stats()
+{
+	std::vector<browser_stat> result;
+	result.reserve(hosts.size());
+	for (const browser_host *host : hosts)
+		result.push_back(host->stat());
+	return result;
+}
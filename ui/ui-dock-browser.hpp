@@ -0,0 +1,80 @@
+// Copyright (C) 2023 Noice Inc.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <QHBoxLayout>
+#include <QString>
+#include <QTimer>
+#include <QWidget>
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include "obs/obs-browser.hpp"
+
+namespace noice::ui::dock {
+
+// Browser dock state, for the stats dock
+struct browser_stat {
+	QString name;
+	bool loaded;
+	bool shown;
+	// Until the hidden browser is torn down, -1 if it is kept
+	int64_t unload_in_ms;
+	// Browsers created since startup
+	uint32_t created;
+	// Time a browser existed since startup
+	uint64_t loaded_ms;
+};
+
+// Dock content that creates its browser when first shown and tears it down once the dock
+// has been hidden longer than "dock.browser.unload_timeout" seconds (default 300, negative
+// keeps it). Only the page address is kept, restoring reloads it from the browser cache.
+// Qt thread only.
+class browser_host : public QWidget {
+	Q_OBJECT;
+
+	QString _name;
+	QHBoxLayout *_layout;
+	QCefWidget *_browser;
+	// Page to load on creation, follows navigation while loaded
+	std::string _url;
+	bool _shown;
+	QTimer _unload_timer;
+
+	uint32_t _created;
+	// os_gettime_ns when the current browser was created
+	uint64_t _loaded_since;
+	uint64_t _loaded_total;
+
+public:
+	browser_host(QWidget *parent, const QString &name);
+	~browser_host();
+
+	// Loads right away when the browser exists, otherwise once it is created
+	void set_url(const std::string &url);
+
+	// Follow the visibility of the dock
+	void set_shown(bool shown);
+
+	browser_stat stat() const;
+
+	static std::vector<browser_stat> stats();
+
+private:
+	void create_browser();
+
+	void destroy_browser();
+};
+} // namespace noice::ui::dock
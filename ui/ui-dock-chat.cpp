@@ -35,14 +35,15 @@ static void service_changed(void *param, calldata_t *data)
 	auto cfg = noice::get_bridge()->configuration_instance();
 	bool deployment_changed = calldata_bool(data, "deployment_changed");
 
+	// Signalled from the graphics thread
 	if (cfg->noice_service_selected() && deployment_changed)
-		self->reset_session();
+		QMetaObject::invokeMethod(self, [self]() { self->reset_session(); }, Qt::QueuedConnection);
 }
 
 noice::ui::dock::chat::chat() : QDockWidget(reinterpret_cast<QWidget *>(obs_frontend_get_main_window()))
 {
-	_browser = obs::browser::instance()->create_widget(this, "");
-	_browser->setMinimumSize(300, 170);
+	// The browser itself is only created once the dock is shown
+	_browser = new browser_host(this, QT_UTF8(obs_module_text(I18N_CHAT.data())));
 
 	setWidget(_browser);
 	setAttribute(Qt::WA_NativeWindow);
@@ -117,12 +118,10 @@ QAction *noice::ui::dock::chat::add_obs_dock()
 
 void noice::ui::dock::chat::reset_session()
 {
-	if (_browser) {
-		auto bridge = noice::get_bridge();
-		std::string token = std::string(bridge->get_unique_identifier());
-		std::string url = bridge->get_web_endpoint("home?machine-token=" + token);
-		_browser->setURL(url);
-	}
+	auto bridge = noice::get_bridge();
+	std::string token = std::string(bridge->get_unique_identifier());
+	std::string url = bridge->get_web_endpoint("home?machine-token=" + token);
+	_browser->set_url(url);
 }
 
 void noice::ui::dock::chat::closeEvent(QCloseEvent *event)
@@ -131,7 +130,10 @@ void noice::ui::dock::chat::closeEvent(QCloseEvent *event)
 	hide();
 }
 
-void noice::ui::dock::chat::on_visibilityChanged(bool visible) {}
+void noice::ui::dock::chat::on_visibilityChanged(bool visible)
+{
+	_browser->set_shown(visible);
+}
 
 void noice::ui::dock::chat::on_topLevelChanged(bool topLevel)
 {
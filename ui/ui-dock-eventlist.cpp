@@ -35,14 +35,15 @@ static void service_changed(void *param, calldata_t *data)
 	auto cfg = noice::get_bridge()->configuration_instance();
 	bool deployment_changed = calldata_bool(data, "deployment_changed");
 
+	// Signalled from the graphics thread
 	if (cfg->noice_service_selected() && deployment_changed)
-		self->reset_session();
+		QMetaObject::invokeMethod(self, [self]() { self->reset_session(); }, Qt::QueuedConnection);
 }
 
 noice::ui::dock::eventlist::eventlist() : QDockWidget(reinterpret_cast<QWidget *>(obs_frontend_get_main_window()))
 {
-	_browser = obs::browser::instance()->create_widget(this, "");
-	_browser->setMinimumSize(300, 170);
+	// The browser itself is only created once the dock is shown
+	_browser = new browser_host(this, QT_UTF8(obs_module_text(I18N_EVENTLIST.data())));
 
 	setWidget(_browser);
 	setAttribute(Qt::WA_NativeWindow);
@@ -118,10 +119,8 @@ QAction *noice::ui::dock::eventlist::add_obs_dock()
 
 void noice::ui::dock::eventlist::reset_session()
 {
-	if (_browser) {
-		std::string url = noice::get_bridge()->get_web_endpoint("");
-		_browser->setURL(url);
-	}
+	std::string url = noice::get_bridge()->get_web_endpoint("");
+	_browser->set_url(url);
 }
 
 void noice::ui::dock::eventlist::closeEvent(QCloseEvent *event)
@@ -130,7 +129,10 @@ void noice::ui::dock::eventlist::closeEvent(QCloseEvent *event)
 	hide();
 }
 
-void noice::ui::dock::eventlist::on_visibilityChanged(bool visible) {}
+void noice::ui::dock::eventlist::on_visibilityChanged(bool visible)
+{
+	_browser->set_shown(visible);
+}
 
 void noice::ui::dock::eventlist::on_topLevelChanged(bool topLevel)
 {
@@ -21,13 +21,13 @@
 #include <QCloseEvent>
 #include <QDockWidget>
 #include <QHBoxLayout>
-#include "obs/obs-browser.hpp"
+#include "ui-dock-browser.hpp"
 
 namespace noice::ui::dock {
 class eventlist : public QDockWidget {
 	Q_OBJECT;
 
-	QCefWidget *_browser;
+	browser_host *_browser;
 
 public:
 	explicit eventlist();
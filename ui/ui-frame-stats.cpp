@@ -33,12 +33,29 @@
 #include <string_view>
 #include <string>
 #include "common.hpp"
+#include "noice-bridge.hpp"
+#include "ui-dock-browser.hpp"
 
 #define TIMER_INTERVAL 2000
 #define REC_TIME_LEFT_INTERVAL 30000
 
 constexpr std::string_view AITUM_MULTI_SERVICE = "aitum_multi_service_";
 
+constexpr std::string_view I18N_OCCLUSION_SOURCE = "Stats.Occlusion.Source";
+constexpr std::string_view I18N_OCCLUSION_REGION = "Stats.Occlusion.Region";
+constexpr std::string_view I18N_OCCLUSION_TOTAL = "Stats.Occlusion.Total";
+constexpr std::string_view I18N_OCCLUSION_LONGEST = "Stats.Occlusion.Longest";
+constexpr std::string_view I18N_OCCLUSION_SHARE = "Stats.Occlusion.Share";
+
+constexpr std::string_view I18N_BROWSER_DOCK = "Stats.Browser.Dock";
+constexpr std::string_view I18N_BROWSER_STATE = "Stats.Browser.State";
+constexpr std::string_view I18N_BROWSER_CREATED = "Stats.Browser.Created";
+constexpr std::string_view I18N_BROWSER_LOADED = "Stats.Browser.Loaded";
+constexpr std::string_view I18N_BROWSER_STATE_SHOWN = "Stats.Browser.State.Shown";
+constexpr std::string_view I18N_BROWSER_STATE_HIDDEN = "Stats.Browser.State.Hidden";
+constexpr std::string_view I18N_BROWSER_STATE_UNLOADING = "Stats.Browser.State.Unloading";
+constexpr std::string_view I18N_BROWSER_STATE_UNLOADED = "Stats.Browser.State.Unloaded";
+
 static void setThemeID(QWidget *widget, const QString &themeID)
 {
 	if (widget->property("themeID").toString() != themeID) {
@@ -88,6 +105,12 @@ static QString MakeTimeLeftText(int hours, int minutes)
 	return QString::asprintf("%d %s, %d %s", hours, Str("Hours"), minutes, Str("Minutes"));
 }
 
+static QString MakeDurationText(uint64_t ms)
+{
+	uint64_t seconds = ms / 1000;
+	return QString::asprintf("%d:%02d:%02d", int(seconds / 3600), int(seconds / 60 % 60), int(seconds % 60));
+}
+
 static QString MakeMissedFramesText(uint32_t total_lagged, uint32_t total_rendered, long double num)
 {
 	return QString("%1 / %2 (%3%)").arg(QString::number(total_lagged), QString::number(total_rendered), QString::number(num, 'f', 1));
@@ -177,8 +200,47 @@ noice::ui::frame::basicstats::basicstats(QWidget *parent, bool closable)
 
 	/* --------------------------------------------- */
 
+	occlusionLayout = new QGridLayout();
+
+	col = 0;
+	auto addOcclusionCol = [&](std::string_view loc) {
+		QLabel *label = new QLabel(QT_UTF8(obs_module_text(loc.data())), this);
+		label->setStyleSheet("font-weight: bold");
+		occlusionLayout->addWidget(label, 0, col++);
+	};
+
+	addOcclusionCol(I18N_OCCLUSION_SOURCE);
+	addOcclusionCol(I18N_OCCLUSION_REGION);
+	addOcclusionCol(I18N_OCCLUSION_TOTAL);
+	addOcclusionCol(I18N_OCCLUSION_LONGEST);
+	addOcclusionCol(I18N_OCCLUSION_SHARE);
+	occlusionLayoutCullSize = occlusionLayout->count();
+
+	/* --------------------------------------------- */
+
+	browserLayout = new QGridLayout();
+
+	col = 0;
+	auto addBrowserCol = [&](std::string_view loc) {
+		QLabel *label = new QLabel(QT_UTF8(obs_module_text(loc.data())), this);
+		label->setStyleSheet("font-weight: bold");
+		browserLayout->addWidget(label, 0, col++);
+	};
+
+	addBrowserCol(I18N_BROWSER_DOCK);
+	addBrowserCol(I18N_BROWSER_STATE);
+	addBrowserCol(I18N_BROWSER_CREATED);
+	addBrowserCol(I18N_BROWSER_LOADED);
+	browserLayoutCullSize = browserLayout->count();
+
+	/* --------------------------------------------- */
+
 	QVBoxLayout *outputContainerLayout = new QVBoxLayout();
 	outputContainerLayout->addLayout(outputLayout);
+	outputContainerLayout->addSpacing(10);
+	outputContainerLayout->addLayout(occlusionLayout);
+	outputContainerLayout->addSpacing(10);
+	outputContainerLayout->addLayout(browserLayout);
 	outputContainerLayout->addStretch();
 
 	QWidget *widget = new QWidget(this);
@@ -299,6 +361,71 @@ void noice::ui::frame::basicstats::UpdateOutputLayout()
 	}
 }
 
+void noice::ui::frame::basicstats::UpdateOcclusions()
+{
+	while (occlusionLayout->count() > occlusionLayoutCullSize) {
+		auto item = occlusionLayout->takeAt(occlusionLayoutCullSize);
+		if (item == nullptr)
+			break;
+		delete item->widget();
+		delete item;
+	}
+
+	auto scene_tracker = noice::get_bridge()->scene_tracker_instance();
+	if (!scene_tracker)
+		return;
+
+	uint64_t observed_ms = 0;
+	std::vector<noice::source::occlusion_stat> stats = scene_tracker->get_occlusion_stats(observed_ms);
+
+	int row = 0;
+	for (const noice::source::occlusion_stat &stat : stats) {
+		row++;
+		int col = 0;
+
+		occlusionLayout->addWidget(new QLabel(QT_UTF8(stat.source_name.c_str()), this), row, col++);
+		occlusionLayout->addWidget(new QLabel(QT_UTF8(stat.region.c_str()), this), row, col++);
+		QLabel *total = new QLabel(MakeDurationText(stat.total_ms), this);
+		setThemeID(total, stat.active ? "error" : "");
+		occlusionLayout->addWidget(total, row, col++);
+		occlusionLayout->addWidget(new QLabel(MakeDurationText(stat.longest_ms), this), row, col++);
+		occlusionLayout->addWidget(new QLabel(QString::number(stat.fraction * 100.0f, 'f', 1) + QStringLiteral("%"), this), row, col++);
+	}
+}
+
+void noice::ui::frame::basicstats::UpdateBrowsers()
+{
+	while (browserLayout->count() > browserLayoutCullSize) {
+		auto item = browserLayout->takeAt(browserLayoutCullSize);
+		if (item == nullptr)
+			break;
+		delete item->widget();
+		delete item;
+	}
+
+	int row = 0;
+	for (const noice::ui::dock::browser_stat &stat : noice::ui::dock::browser_host::stats()) {
+		row++;
+		int col = 0;
+
+		QString state;
+		if (!stat.loaded)
+			state = QT_UTF8(obs_module_text(I18N_BROWSER_STATE_UNLOADED.data()));
+		else if (stat.shown)
+			state = QT_UTF8(obs_module_text(I18N_BROWSER_STATE_SHOWN.data()));
+		else if (stat.unload_in_ms >= 0)
+			state = QT_UTF8(obs_module_text(I18N_BROWSER_STATE_UNLOADING.data()))
+					.arg(MakeDurationText((uint64_t)stat.unload_in_ms));
+		else
+			state = QT_UTF8(obs_module_text(I18N_BROWSER_STATE_HIDDEN.data()));
+
+		browserLayout->addWidget(new QLabel(stat.name, this), row, col++);
+		browserLayout->addWidget(new QLabel(state, this), row, col++);
+		browserLayout->addWidget(new QLabel(QString::number(stat.created), this), row, col++);
+		browserLayout->addWidget(new QLabel(MakeDurationText(stat.loaded_ms), this), row, col++);
+	}
+}
+
 static uint32_t first_encoded = 0xFFFFFFFF;
 static uint32_t first_skipped = 0xFFFFFFFF;
 static uint32_t first_rendered = 0xFFFFFFFF;
@@ -568,6 +695,14 @@ void noice::ui::frame::basicstats::Update()
 			bitrates.push_back(kbps);
 		}
 	}
+
+	/* ------------------------------------------- */
+	/* validator occlusions                        */
+	UpdateOcclusions();
+
+	/* ------------------------------------------- */
+	/* browser docks                               */
+	UpdateBrowsers();
 }
 
 void noice::ui::frame::basicstats::StartRecTimeLeft()
@@ -47,6 +47,12 @@ class basicstats : public QFrame {
 	QGridLayout *outputLayout = nullptr;
 	int outputLayoutCullSize = 0;
 
+	QGridLayout *occlusionLayout = nullptr;
+	int occlusionLayoutCullSize = 0;
+
+	QGridLayout *browserLayout = nullptr;
+	int browserLayoutCullSize = 0;
+
 	os_cpu_usage_info_t *cpu_info = nullptr;
 
 	QTimer timer;
@@ -85,6 +91,8 @@ class basicstats : public QFrame {
 
 	void AddOutputLabels(obs_weak_output_t *outputWeak, bool rec, QString name);
 	void UpdateOutputLayout();
+	void UpdateOcclusions();
+	void UpdateBrowsers();
 	void Update();
 
 	virtual void closeEvent(QCloseEvent *event) override;
@@ -18,6 +18,7 @@
 
 #include "ui.hpp"
 #include <QDesktopServices>
+#include <QFileDialog>
 #include <QMainWindow>
 #include <QMenuBar>
 #include <QTranslator>
@@ -32,6 +33,11 @@
 static constexpr std::string_view I18N_MENU = "Menu";
 static constexpr std::string_view I18N_MENU_CHECKFORUPDATES = "Menu.CheckForUpdates";
 static constexpr std::string_view I18N_MENU_ABOUT = "Menu.About";
+static constexpr std::string_view I18N_MENU_RECORDTRACE = "Menu.RecordTrace";
+static constexpr std::string_view I18N_MENU_SAVETRACE = "Menu.SaveTrace";
+static constexpr std::string_view I18N_MENU_SAVETRACE_FILTER = "Menu.SaveTrace.Filter";
+static constexpr std::string_view I18N_MENU_SAVESCENERECORDING = "Menu.SaveSceneRecording";
+static constexpr std::string_view I18N_MENU_SAVESCENERECORDING_FILTER = "Menu.SaveSceneRecording.Filter";
 
 class noice_translator : public QTranslator {
 public:
@@ -69,6 +75,9 @@ noice::ui::ui::ui()
 	  _menu_action(),
 	  _update_action(),
 	  _about_action(),
+	  _trace_action(),
+	  _save_trace_action(),
+	  _save_scene_recording_action(),
 	  _chat_dock(),
 	  _chat_dock_action(),
 	  _eventlist_dock(),
@@ -180,6 +189,20 @@ void noice::ui::ui::load()
 
 		_menu->addSeparator();
 
+		// Add Tracing
+		_trace_action = _menu->addAction(obs_module_text(I18N_MENU_RECORDTRACE.data()));
+		_trace_action->setCheckable(true);
+		_trace_action->setChecked(noice::get_bridge()->tracing());
+		connect(_trace_action, &QAction::toggled, this, &noice::ui::ui::menu_trace_toggled);
+
+		_save_trace_action = _menu->addAction(obs_module_text(I18N_MENU_SAVETRACE.data()));
+		connect(_save_trace_action, &QAction::triggered, this, &noice::ui::ui::menu_save_trace_triggered);
+
+		_save_scene_recording_action = _menu->addAction(obs_module_text(I18N_MENU_SAVESCENERECORDING.data()));
+		connect(_save_scene_recording_action, &QAction::triggered, this, &noice::ui::ui::menu_save_scene_recording_triggered);
+
+		_menu->addSeparator();
+
 		// Add About
 		_about_action = _menu->addAction(obs_module_text(I18N_MENU_ABOUT.data()));
 		_about_action->setMenuRole(QAction::NoRole);
@@ -262,6 +285,34 @@ void noice::ui::ui::menu_about_triggered(bool)
 	QDesktopServices::openUrl(QUrl(QT_UTF8("https://noice.com")));
 }
 
+void noice::ui::ui::menu_trace_toggled(bool checked)
+{
+	noice::get_bridge()->set_tracing(checked);
+}
+
+void noice::ui::ui::menu_save_trace_triggered(bool)
+{
+	QString path = QFileDialog::getSaveFileName(reinterpret_cast<QWidget *>(obs_frontend_get_main_window()),
+						    QT_UTF8(obs_module_text(I18N_MENU_SAVETRACE.data())), QString("obs-noice-trace.json"),
+						    QT_UTF8(obs_module_text(I18N_MENU_SAVETRACE_FILTER.data())));
+	if (path.isEmpty())
+		return;
+
+	noice::get_bridge()->save_trace(path.toStdString());
+}
+
+void noice::ui::ui::menu_save_scene_recording_triggered(bool)
+{
+	QString path = QFileDialog::getSaveFileName(reinterpret_cast<QWidget *>(obs_frontend_get_main_window()),
+						    QT_UTF8(obs_module_text(I18N_MENU_SAVESCENERECORDING.data())),
+						    QString("obs-noice-scene.nsr"),
+						    QT_UTF8(obs_module_text(I18N_MENU_SAVESCENERECORDING_FILTER.data())));
+	if (path.isEmpty())
+		return;
+
+	noice::get_bridge()->save_scene_recording(path.toStdString());
+}
+
 std::shared_ptr<noice::ui::ui> noice::ui::ui::_instance = nullptr;
 
 void noice::ui::ui::initialize()
@@ -38,6 +38,9 @@ private:
 	QAction *_menu_action;
 	QAction *_update_action;
 	QAction *_about_action;
+	QAction *_trace_action;
+	QAction *_save_trace_action;
+	QAction *_save_scene_recording_action;
 
 	QSharedPointer<dock::chat> _chat_dock;
 	QAction *_chat_dock_action;
@@ -68,6 +71,12 @@ private slots:
 
 	void menu_about_triggered(bool);
 
+	void menu_trace_toggled(bool);
+
+	void menu_save_trace_triggered(bool);
+
+	void menu_save_scene_recording_triggered(bool);
+
 private /* Singleton */:
 	static std::shared_ptr<noice::ui::ui> _instance;
 